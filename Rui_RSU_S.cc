@@ -10,13 +10,14 @@
 #include "ns3/csma-helper.h"
 
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-cluster-config.h"
 
 #include "ns3/simulator.h"
 
 using namespace std;
 using namespace ns3;
 
-// Don’t forget to change the drop rate to 0: static double error_rate = 0; in rui-vehicle-beta.h.
+// Don’t forget to set the drop rate to 0: --errorRate=0.
 
 vector<double> sendtime;
 vector<double> recvtime;
@@ -87,6 +88,13 @@ NewConnectionCreated(Ptr<Socket> Socket,const Address &clientaddress)
 int main(int argc, char *argv[])
 {
   LogComponentEnable("EleventhScriptExample",LOG_LEVEL_ALL);
+
+  ClusterConfig cluster;
+  CommandLine cmd;
+  cluster.AddCommandLineValues (cmd);
+  cmd.Parse (argc, argv);
+  cluster.Apply ();
+
   NodeContainer nodes;
   nodes.Create(2);
  
@@ -10,10 +10,11 @@
 #include "ns3/csma-helper.h"
 
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-cluster-config.h"
 
 #include "ns3/simulator.h"
 
-// Don’t forget to change the drop rate to 0: static double error_rate = 0; in rui-vehicle-beta.h.
+// Don’t forget to set the drop rate to 0: --errorRate=0.
 
 using namespace std;
 using namespace ns3;
@@ -88,9 +89,12 @@ int main(int argc, char *argv[])
 
   uint32_t m_seed = 1;
 
+  ClusterConfig cluster;
   CommandLine cmd;
   cmd.AddValue ("seed", "randomize seed", m_seed);
+  cluster.AddCommandLineValues (cmd);
   cmd.Parse (argc, argv);
+  cluster.Apply ();
 
   SeedManager::SetSeed (m_seed);
 
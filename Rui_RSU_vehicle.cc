@@ -54,6 +54,7 @@
 #include "ns3/netanim-module.h" 
 #include "ns3/simulator.h"
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-cluster-config.h"
 //#include "ns3/stats-module.h"
 //#include "ns3/network-module.h"
 
@@ -142,6 +143,7 @@ int main (int argc, char *argv[])
   bool verbose = false;
   double m_txp = 55;
 
+  ClusterConfig cluster;
   CommandLine cmd;
 
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
@@ -149,7 +151,9 @@ int main (int argc, char *argv[])
   cmd.AddValue ("numPackets", "number of packets generated", numPackets);
   cmd.AddValue ("interval", "interval (seconds) between packets", interval);
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
+  cluster.AddCommandLineValues (cmd);
   cmd.Parse (argc, argv);
+  cluster.Apply ();
   Time interPacketInterval = Seconds (interval);
 
 
@@ -53,6 +53,7 @@
 //#include "ns3/tag.h"
 #include "ns3/simulator.h"
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-cluster-config.h"
 //#include "ns3/stats-module.h"
 //#include "ns3/network-module.h"
 
@@ -149,6 +150,7 @@ int main (int argc, char *argv[])
   double m_txp = 100;
   uint32_t m_seed = 1;
 
+  ClusterConfig cluster;
   CommandLine cmd;
 
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
@@ -157,7 +159,9 @@ int main (int argc, char *argv[])
   cmd.AddValue ("interval", "interval (seconds) between packets", interval);
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
   cmd.AddValue ("seed", "randomize seed", m_seed);
+  cluster.AddCommandLineValues (cmd);
   cmd.Parse (argc, argv);
+  cluster.Apply ();
 
   SeedManager::SetSeed (m_seed);
 
@@ -64,15 +64,16 @@
 #include <list>//added Rui
 #include <map>
 #include "ns3/rui-vehicle-beta.h"
+#include "ns3/rui-cluster-config.h"
 
 #include "ns3/ns2-mobility-helper.h"
+#include "ns3/rui-mobility-trace.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("WifiSimpleOcb");
 
 std::vector<double> end_to_end_delay;
-extern map<int, int> node_ID_to_index;
 
 /*
  * In WAVE module, there is no net device class named like "Wifi80211pNetDevice",
@@ -152,6 +153,7 @@ int main (int argc, char *argv[])
   bool verbose = false;
   double m_txp = 55;
 
+  ClusterConfig cluster;
   CommandLine cmd;
 
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
@@ -159,7 +161,9 @@ int main (int argc, char *argv[])
   cmd.AddValue ("numPackets", "number of packets generated", numPackets);
   cmd.AddValue ("interval", "interval (seconds) between packets", interval);
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
+  cluster.AddCommandLineValues (cmd);
   cmd.Parse (argc, argv);
+  cluster.Apply ();
   // Convert to time object
   Time interPacketInterval = Seconds (interval);
 
@@ -170,8 +174,17 @@ int main (int argc, char *argv[])
   m_mobilityNodes.Create (m_nNodes);
 
   std::string m_traceFile = "trace_acosta_rui.tcl";
-  Ns2MobilityHelper ns2 = Ns2MobilityHelper (m_traceFile);
-  ns2.Install ();
+  //Rui: the binary trace made by Rui_trace_convert.cc is mapped instead of parsed, when it exists
+  std::string binaryTrace = FindBinaryMobilityTrace (m_traceFile);
+  if (!binaryTrace.empty ())
+    {
+      BinaryMobilityHelper (binaryTrace).Install ();
+    }
+  else
+    {
+      Ns2MobilityHelper ns2 = Ns2MobilityHelper (m_traceFile);
+      ns2.Install ();
+    }
   
 
   std::cout<<"install mobility to 1004 nodes"<<endl;
@@ -181,7 +194,7 @@ int main (int argc, char *argv[])
   c.Create (1);
 
   //add the head as vehicle
-  Ptr<Node> p = m_mobilityNodes.Get(head_node);
+  Ptr<Node> p = m_mobilityNodes.Get(node_list[head_node]);
   std::cout<<"Node"<<p->GetId ()<<"add to list c, as the head"<<endl;
   c.Add(p);
 
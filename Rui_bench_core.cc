@@ -0,0 +1,631 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Rui: microbenchmarks of the coding core (rui-crs-core.h), without ns-3. Built by
+ * CMakeLists.txt:
+ *
+ *   cmake -S . -B build && cmake --build build
+ *   build/Rui_bench_core --sizes=10,20,50 --entries=1,2000 --loss=0,0.2 > bench.csv
+ *
+ * For each cluster size, entry count and loss rate, a round of packets is made: every
+ * member but the head sends its masked observation, directly or through 1 to 3 relays
+ * of the cluster, and each packet is lost with the loss rate. The round is then timed
+ * step by step as the head meets it. With one entry the scalar paths are timed
+ * (RelayEncode, MessageHandle, FunctionsClean, SetParameters), otherwise the instance
+ * ones; encode_contribution times the instance encoding with the contributions of
+ * the relays built beforehand (RelayContribution). mask_batch times the same masks as mask, on all entries of a vehicle at once
+ * (MaskObservations), and mask_pairwise times the pairwise masks (PairwiseMasker) of one vehicle.
+ * encode_gf, encode_gf_contribution (RelayFieldContribution) and handle_gf time the same round
+ * coded over GF(2^8) (CodedPacket::SetFieldValues), their kernel column naming the GF kernel
+ * (GfKernelName). encode_fixed and handle_fixed time it quantized to 16 bits (Quantize,
+ * CodedPacket::SetFixedValues) with betas of 8 bits, coded in int64 by the relays
+ * (RelayEncodeQuantized) and decoded modulo 2^61-1 by the head.
+ * Output, one CSV line per step:
+ *
+ *   bench,kernel,size,entries,loss,reps,ops,mean_ns,min_ns
+ *
+ * ops is the number of calls in one repetition (e.g. the packets of a round), and the
+ * times are per call.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "rui-crs-core.h"
+#include "rui-coding-kernel.h"
+#include "rui-gf256.h"
+
+namespace {
+
+struct BenchCase
+{
+  int size;
+  int entries;
+  double loss;
+};
+
+/// A packet of a round: its source and the relays it goes through
+struct Route
+{
+  int source;
+  std::vector<int> relays;
+  bool lost;
+};
+
+/// The cluster and the round of packets of a case
+struct Round
+{
+  std::vector<double> beta;
+  std::vector<std::vector<double> > masked; //masked entries of each vehicle
+  std::vector<Route> routes;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double
+ElapsedNs (Clock::time_point begin)
+{
+  return std::chrono::duration<double, std::nano> (Clock::now () - begin).count ();
+}
+
+template <class T>
+std::vector<T>
+ParseList (const std::string &text)
+{
+  std::vector<T> values;
+  std::stringstream ss (text);
+  std::string token;
+  while (std::getline (ss, token, ','))
+    {
+      std::stringstream value (token);
+      T v;
+      if (!(value >> v))
+        {
+          std::cerr << "Bad value " << token << std::endl;
+          std::exit (1);
+        }
+      values.push_back (v);
+    }
+  return values;
+}
+
+Round
+MakeRound (const BenchCase &c, int head, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<double> beta (0.1, 1.0);
+  std::uniform_int_distribution<int> obser (50, 70);
+  std::uniform_real_distribution<double> drop (0.0, 1.0);
+  Round round;
+  for (int i = 0; i < c.size; i++)
+    {
+      round.beta.push_back (beta (rng));
+      std::vector<double> entries (c.entries);
+      for (double &e : entries)
+        {
+          e = MaskObservation (obser (rng), i, c.size);
+        }
+      round.masked.push_back (entries);
+    }
+  for (int source = 0; source < c.size; source++)
+    {
+      if (source == head)
+        {
+          continue;
+        }
+      Route route;
+      route.source = source;
+      int hops = std::uniform_int_distribution<int> (0, 3) (rng);
+      while ((int) route.relays.size () < hops && (int) route.relays.size () < c.size - 2)
+        {
+          int relay = std::uniform_int_distribution<int> (0, c.size - 1) (rng);
+          if (relay != source && relay != head
+              && std::find (route.relays.begin (), route.relays.end (), relay) == route.relays.end ())
+            {
+              route.relays.push_back (relay);
+            }
+        }
+      route.lost = drop (rng) < c.loss;
+      round.routes.push_back (route);
+    }
+  return round;
+}
+
+CodedPacket
+OriginalPacket (const Round &round, const Route &route, int size)
+{
+  CodedPacket packet;
+  packet.SetType (CodedPacket::ORIGINAL);
+  packet.SetInstance (round.masked[route.source].size () > 1);
+  packet.SetGroupSize (size);
+  packet.SetValues (round.masked[route.source]);
+  return packet;
+}
+
+/// The same packet, its values as bytes symbols of GF(2^8)
+CodedPacket
+FieldPacket (const Round &round, const Route &route, int size, uint8_t bytes)
+{
+  CodedPacket packet = OriginalPacket (round, route, size);
+  if (!packet.SetFieldValues (round.masked[route.source], 0, bytes))
+    {
+      std::cerr << "Masked values of vehicle " << route.source << " do not fit " << (int) bytes << " bytes" << std::endl;
+      std::exit (1);
+    }
+  return packet;
+}
+
+/// The same packet, its values quantized
+CodedPacket
+FixedPacket (const Round &round, const Route &route, int size, const std::vector<Quantized> &quantized)
+{
+  CodedPacket packet = OriginalPacket (round, route, size);
+  packet.SetFixedValues (quantized[route.source].scale, quantized[route.source].integers);
+  return packet;
+}
+
+bool
+Encode (CodedPacket &packet, const Round &round, int relay, int source)
+{
+  if (packet.IsInstance ())
+    {
+      return RelayEncodeInstance (packet, relay, source, round.beta, round.masked[relay]);
+    }
+  return RelayEncode (packet, relay, source, round.beta, round.masked[relay][0]);
+}
+
+class Bench
+{
+public:
+  Bench (std::ostream &os, int reps)
+    : m_os (os),
+      m_reps (reps)
+  {
+  }
+
+  /// Report the times of run (), which returns the ns taken by ops calls
+  template <class F>
+  void Run (const std::string &name, const BenchCase &c, int ops, F run, const char *kernel = CodingKernelName ())
+  {
+    if (ops == 0)
+      {
+        return;
+      }
+    run (); //warm up
+    double sum = 0;
+    double best = 0;
+    for (int r = 0; r < m_reps; r++)
+      {
+        double ns = run ();
+        sum += ns;
+        best = (r == 0) ? ns : std::min (best, ns);
+      }
+    m_os << name << "," << kernel << "," << c.size << "," << c.entries << "," << c.loss
+         << "," << m_reps << "," << ops << "," << sum / m_reps / ops << "," << best / ops << std::endl;
+  }
+
+private:
+  std::ostream &m_os;
+  int m_reps;
+};
+
+void
+RunCase (Bench &bench, const BenchCase &c, std::mt19937 &rng)
+{
+  int head = c.size / 2;
+  bool instance = c.entries > 1;
+  Round round = MakeRound (c, head, rng);
+
+  // masking, per entry as the programs do
+  bench.Run ("mask", c, c.size * c.entries, [&] () {
+    volatile int sink = 0;
+    Clock::time_point begin = Clock::now ();
+    for (int i = 0; i < c.size; i++)
+      {
+        for (int e = 0; e < c.entries; e++)
+          {
+            sink = sink + MaskObservation (60, i, c.size);
+          }
+      }
+    return ElapsedNs (begin);
+  });
+
+  // the same masks, all entries of each vehicle in one pass with the offsets set up once
+  std::vector<int> offsets = MaskOffsets (c.size);
+  std::vector<double> observations (c.entries);
+  bench.Run ("mask_batch", c, c.size * c.entries, [&] () {
+    Clock::time_point begin = Clock::now ();
+    for (int i = 0; i < c.size; i++)
+      {
+        std::fill (observations.begin (), observations.end (), 60.0);
+        MaskObservations (observations.data (), observations.size (), offsets[i]);
+      }
+    return ElapsedNs (begin);
+  });
+
+  // pairwise masks of one vehicle, every entry against the size - 1 other vehicles
+  PairwiseMasker masker (1, c.size, 20);
+  std::vector<double> values (c.entries);
+  bench.Run ("mask_pairwise", c, c.entries, [&] () {
+    Clock::time_point begin = Clock::now ();
+    masker.Mask (head, values.data (), values.size ());
+    return ElapsedNs (begin);
+  });
+
+  // parsing a legacy text payload, e.g. IT|3+5|A|B|C
+  std::stringstream text;
+  text.precision (17);
+  text << "IT|3+5";
+  for (double v : round.masked[0])
+    {
+      text << "|" << v;
+    }
+  std::string payload = text.str ();
+  bench.Run ("split", c, c.entries, [&] () {
+    double sum = 0;
+    Clock::time_point begin = Clock::now ();
+    std::vector<std::string_view> tokens = split (payload, "|");
+    for (std::size_t k = 2; k < tokens.size (); k++)
+      {
+        double v;
+        ParseNumber (tokens[k], v);
+        sum += v;
+      }
+    double ns = ElapsedNs (begin);
+    volatile double sink = sum;
+    (void) sink;
+    return ns;
+  });
+
+  // relay encoding, every hop of every packet of the round
+  int hops = 0;
+  for (const Route &route : round.routes)
+    {
+      hops += route.relays.size ();
+    }
+  bench.Run (instance ? "encode_instance" : "encode", c, hops, [&] () {
+    double ns = 0;
+    for (const Route &route : round.routes)
+      {
+        CodedPacket packet = OriginalPacket (round, route, c.size);
+        Clock::time_point begin = Clock::now ();
+        for (int relay : route.relays)
+          {
+            Encode (packet, round, relay, route.source);
+          }
+        ns += ElapsedNs (begin);
+      }
+    return ns;
+  });
+
+  // the same with the contribution of each relay built once (RelayContribution)
+  if (instance)
+    {
+      std::vector<AlignedVector> contribution;
+      for (int i = 0; i < c.size; i++)
+        {
+          contribution.push_back (RelayContribution (round.beta[i], round.masked[i]));
+        }
+      bench.Run ("encode_contribution", c, hops, [&] () {
+        double ns = 0;
+        for (const Route &route : round.routes)
+          {
+            CodedPacket packet = OriginalPacket (round, route, c.size);
+            Clock::time_point begin = Clock::now ();
+            for (int relay : route.relays)
+              {
+                RelayEncodeInstance (packet, relay, route.source, round.beta[route.source], contribution[relay]);
+              }
+            ns += ElapsedNs (begin);
+          }
+        return ns;
+      });
+    }
+
+  // the packets the head receives
+  std::vector<CodedPacket> received;
+  std::vector<int> received_from;
+  for (const Route &route : round.routes)
+    {
+      if (route.lost)
+        {
+          continue;
+        }
+      CodedPacket packet = OriginalPacket (round, route, c.size);
+      for (int relay : route.relays)
+        {
+          Encode (packet, round, relay, route.source);
+        }
+      received.push_back (packet);
+      received_from.push_back (route.source);
+    }
+
+  // bookkeeping at the head, online decoding included
+  bench.Run (instance ? "handle_instance" : "handle", c, received.size (), [&] () {
+    DataManagementHelper helper (c.size - 1, round.beta, c.entries);
+    Clock::time_point begin = Clock::now ();
+    for (std::size_t k = 0; k < received.size (); k++)
+      {
+        if (instance)
+          {
+            helper.MessageHandleInstance (received[k], received_from[k]);
+          }
+        else
+          {
+            helper.MessageHandle (received[k], received_from[k]);
+          }
+      }
+    return ElapsedNs (begin);
+  });
+
+  // the round coded over GF(2^8): the encoding, and the bookkeeping with the online decoding
+  double max_masked = 0;
+  for (const std::vector<double> &entries : round.masked)
+    {
+      for (double v : entries)
+        {
+          max_masked = std::max (max_masked, std::fabs (v));
+        }
+    }
+  uint8_t bytes = FixedPointBytes (max_masked, 1, 1);
+  bench.Run ("encode_gf", c, hops, [&] () {
+    double ns = 0;
+    for (const Route &route : round.routes)
+      {
+        CodedPacket packet = FieldPacket (round, route, c.size, bytes);
+        Clock::time_point begin = Clock::now ();
+        for (int relay : route.relays)
+          {
+            Encode (packet, round, relay, route.source);
+          }
+        ns += ElapsedNs (begin);
+      }
+    return ns;
+  }, GfKernelName ());
+  if (instance)
+    {
+      std::vector<std::vector<uint8_t> > contribution;
+      for (int i = 0; i < c.size; i++)
+        {
+          contribution.push_back (RelayFieldContribution (round.masked[i], bytes));
+        }
+      bench.Run ("encode_gf_contribution", c, hops, [&] () {
+        double ns = 0;
+        for (const Route &route : round.routes)
+          {
+            CodedPacket packet = FieldPacket (round, route, c.size, bytes);
+            Clock::time_point begin = Clock::now ();
+            for (int relay : route.relays)
+              {
+                RelayEncodeInstance (packet, relay, route.source, contribution[relay]);
+              }
+            ns += ElapsedNs (begin);
+          }
+        return ns;
+      }, GfKernelName ());
+    }
+  std::vector<CodedPacket> received_gf;
+  for (const Route &route : round.routes)
+    {
+      if (route.lost)
+        {
+          continue;
+        }
+      CodedPacket packet = FieldPacket (round, route, c.size, bytes);
+      for (int relay : route.relays)
+        {
+          Encode (packet, round, relay, route.source);
+        }
+      received_gf.push_back (packet);
+    }
+  bench.Run ("handle_gf", c, received_gf.size (), [&] () {
+    DataManagementHelper helper (c.size - 1, round.beta, c.entries);
+    Clock::time_point begin = Clock::now ();
+    for (std::size_t k = 0; k < received_gf.size (); k++)
+      {
+        if (instance)
+          {
+            helper.MessageHandleInstance (received_gf[k], received_from[k]);
+          }
+        else
+          {
+            helper.MessageHandle (received_gf[k], received_from[k]);
+          }
+      }
+    return ElapsedNs (begin);
+  }, GfKernelName ());
+
+  // the round quantized, with the integer betas: the encoding in int64, and the bookkeeping
+  // with the online decoding modulo the prime
+  std::vector<double> fixed_beta = FixedPointBeta (round.beta, 8);
+  std::vector<Quantized> quantized (c.size);
+  for (int i = 0; i < c.size; i++)
+    {
+      Quantize (round.masked[i], 16, quantized[i]);
+    }
+  bench.Run ("encode_fixed", c, hops, [&] () {
+    double ns = 0;
+    for (const Route &route : round.routes)
+      {
+        CodedPacket packet = FixedPacket (round, route, c.size, quantized);
+        Clock::time_point begin = Clock::now ();
+        for (int relay : route.relays)
+          {
+            RelayEncodeQuantized (packet, relay, route.source, fixed_beta, quantized[relay]);
+          }
+        ns += ElapsedNs (begin);
+      }
+    return ns;
+  }, "scalar");
+  std::vector<CodedPacket> received_fixed;
+  for (const Route &route : round.routes)
+    {
+      if (route.lost)
+        {
+          continue;
+        }
+      CodedPacket packet = FixedPacket (round, route, c.size, quantized);
+      for (int relay : route.relays)
+        {
+          RelayEncodeQuantized (packet, relay, route.source, fixed_beta, quantized[relay]);
+        }
+      received_fixed.push_back (packet);
+    }
+  bench.Run ("handle_fixed", c, received_fixed.size (), [&] () {
+    DataManagementHelper helper (c.size - 1, fixed_beta, c.entries);
+    Clock::time_point begin = Clock::now ();
+    for (std::size_t k = 0; k < received_fixed.size (); k++)
+      {
+        if (instance)
+          {
+            helper.MessageHandleInstance (received_fixed[k], received_from[k]);
+          }
+        else
+          {
+            helper.MessageHandle (received_fixed[k], received_from[k]);
+          }
+      }
+    return ElapsedNs (begin);
+  }, "scalar");
+
+  // batch decoding: cleaning the functions, then the elimination
+  DataManagementHelper helper (c.size - 1, round.beta, c.entries);
+  helper.SetKeepBatch (true);
+  for (std::size_t k = 0; k < received.size (); k++)
+    {
+      if (instance)
+        {
+          helper.MessageHandleInstance (received[k], received_from[k]);
+        }
+      else
+        {
+          helper.MessageHandle (received[k], received_from[k]);
+        }
+    }
+  bench.Run (instance ? "clean_instance" : "clean", c, 1, [&] () {
+    DataManagementHelper copy = helper;
+    Clock::time_point begin = Clock::now ();
+    if (instance)
+      {
+        copy.FunctionsCleanInstance ();
+      }
+    else
+      {
+        copy.FunctionsClean ();
+      }
+    return ElapsedNs (begin);
+  });
+  DataManagementHelper cleaned = helper;
+  if (instance)
+    {
+      cleaned.FunctionsCleanInstance ();
+    }
+  else
+    {
+      cleaned.FunctionsClean ();
+    }
+  std::vector<int> id_map = cleaned.GetID_Map ();
+  std::vector<std::vector<double> > coef = instance ? cleaned.GetCoefBatch () : cleaned.GetCoef ();
+  bench.Run (instance ? "solve_instance" : "solve", c, coef.empty () ? 0 : 1, [&] () {
+    DataRecoveryHelper recovery;
+    Clock::time_point begin = Clock::now ();
+    if (instance)
+      {
+        recovery.SetParametersBatch (id_map.size (), coef.size (), coef, cleaned.GetRhsBatch (), c.entries);
+      }
+    else
+      {
+        recovery.SetParameters (id_map.size (), coef.size (), coef);
+      }
+    recovery.pc ();
+    return ElapsedNs (begin);
+  });
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string sizes = "20";
+  std::string entries = "1,2000";
+  std::string loss = "0,0.1,0.3";
+  int reps = 20;
+  unsigned seed = 1;
+  std::string output = "";
+
+  for (int i = 1; i < argc; i++)
+    {
+      std::string arg = argv[i];
+      std::size_t eq = arg.find ('=');
+      std::string name = arg.substr (0, eq);
+      std::string value = (eq == std::string::npos) ? "" : arg.substr (eq + 1);
+      if (name == "--sizes")
+        {
+          sizes = value;
+        }
+      else if (name == "--entries")
+        {
+          entries = value;
+        }
+      else if (name == "--loss")
+        {
+          loss = value;
+        }
+      else if (name == "--reps")
+        {
+          reps = std::atoi (value.c_str ());
+        }
+      else if (name == "--seed")
+        {
+          seed = std::atoi (value.c_str ());
+        }
+      else if (name == "--output")
+        {
+          output = value;
+        }
+      else
+        {
+          std::cerr << "Usage: " << argv[0] << " [--sizes=20] [--entries=1,2000] [--loss=0,0.1,0.3]"
+                    << " [--reps=20] [--seed=1] [--output=file.csv]" << std::endl;
+          return 1;
+        }
+    }
+
+  std::ofstream file;
+  if (!output.empty ())
+    {
+      file.open (output);
+      if (!file)
+        {
+          std::cerr << "Cannot write " << output << std::endl;
+          return 1;
+        }
+    }
+  std::ostream &os = output.empty () ? std::cout : file;
+  os << "bench,kernel,size,entries,loss,reps,ops,mean_ns,min_ns" << std::endl;
+
+  Bench bench (os, std::max (reps, 1));
+  std::mt19937 rng (seed);
+  for (int size : ParseList<int> (sizes))
+    {
+      for (int n : ParseList<int> (entries))
+        {
+          for (double l : ParseList<double> (loss))
+            {
+              if (size < 2 || n < 1)
+                {
+                  std::cerr << "Need at least 2 vehicles and 1 entry" << std::endl;
+                  return 1;
+                }
+              RunCase (bench, BenchCase {size, n, l}, rng);
+            }
+        }
+    }
+  return 0;
+}
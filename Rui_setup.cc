@@ -55,6 +55,8 @@ Instead of two node communication, we modify it to cluster communication.
 #include "ns3/wave-mac-helper.h"
 
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-vehicle-beta.h"
+#include "ns3/rui-cluster-config.h"
 #include "ns3/netanim-module.h" 
 
 using namespace ns3;
@@ -89,7 +91,7 @@ std::vector<double> end_to_end_delay;
  * \param socket Rx socket
  */
 
-map<Ipv4Address, int> address_to_id;
+static DenseIdMap address_to_id; //Rui: to map IP addresses (Ipv4Address::Get) to vehicle IDs
 
 
 static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize,
@@ -135,14 +137,14 @@ void ReceivePacket (Ptr<Socket> socket)
         if (packet->FindFirstMatchingByteTag (timestamp)) {
           Time tx = timestamp.GetTimestamp (); //Send time
           Time e2e_delay = receive_time - tx;
-          int source_id = address_to_id.at(addr.GetIpv4 ());
+          int source_id = address_to_id.At(addr.GetIpv4 ().Get ());
           int receive_id = socket->GetNode ()->GetId();
           std::cout << "t= " << Simulator::Now() << receive_id<< " Received one packet! from "<< source_id<<" The send time is:" << tx.GetSeconds() <<"The size is "<< packet->GetSize() << std::endl;
           NS_LOG_INFO("source_id:"<< source_id<<"receive_id"<<receive_id);
           if (source_id<receive_id)//receive it and add my list
           {
             NS_LOG_INFO("source_id<receive_id");
-            if (receive_id!=19)
+            if (receive_id!=group_size-1)
             {
  
               int size=packet->GetSize();//+256;//+256; 
@@ -186,6 +188,7 @@ int main (int argc, char *argv[])
   double interval = 0.0; 
   bool verbose = false;
 
+  ClusterConfig cluster;
   CommandLine cmd (__FILE__);
 
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
@@ -193,13 +196,15 @@ int main (int argc, char *argv[])
   cmd.AddValue ("numPackets", "number of packets generated", numPackets);
   cmd.AddValue ("interval", "interval (seconds) between packets", interval);
   cmd.AddValue ("verbose", "turn on all WifiNetDevice log components", verbose);
+  cluster.AddCommandLineValues (cmd);
   cmd.Parse (argc, argv);
+  cluster.Apply ();
   // Convert to time object
   Time interPacketInterval = Seconds (interval);
 
 
   NodeContainer c;
-  c.Create (20);
+  c.Create (group_size);
 
   // The below set of helpers will help us to put together the wifi NICs we want
   YansWifiPhyHelper wifiPhy;
@@ -268,13 +273,13 @@ int main (int argc, char *argv[])
   for (int j = 0; j < c.GetN(); ++j)
   {
     //Ipv4Address address_ipv4;
-    address_to_id.insert(make_pair(i.GetAddress(j),c.Get(j)->GetId()));//Ipv4Address(d.Get(i)->GetAddress())
+    address_to_id.Insert(i.GetAddress(j).Get (),c.Get(j)->GetId());//Ipv4Address(d.Get(i)->GetAddress())
   }
 
   
   TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
 
-  for (int j=0; j<20; j++)
+  for (int j=0; j<group_size; j++)
   {
     Ptr<Socket> recvSink = Socket::CreateSocket (c.Get (j), tid);
     InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), 80);//i.GetAddress (j)
@@ -282,7 +287,7 @@ int main (int argc, char *argv[])
     recvSink->SetRecvCallback (MakeCallback (&ReceivePacket));
 
   }
-  for (int j=0; j<20; j++)
+  for (int j=0; j<group_size; j++)
   {
     Ptr<Socket> source = Socket::CreateSocket (c.Get (j), tid);
     InetSocketAddress remote = InetSocketAddress (Ipv4Address ("255.255.255.255"), 80);
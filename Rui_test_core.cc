@@ -0,0 +1,717 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Rui: checks of the coding core (rui-crs-core.h), without ns-3. Built by
+ * CMakeLists.txt and run by ctest:
+ *
+ *   cmake -S . -B build && cmake --build build && ctest --test-dir build
+ *
+ * Every vector kernel the CPU has (ChaChaUseKernel, CodingUseKernel, GfUseKernel)
+ * is run against the scalar one; the ChaCha blocks are also checked against the
+ * ChaCha20 block of RFC 8439, section 2.3.2. The CodedPacket wire format is
+ * checked by round trips and truncations, contributors past the cluster
+ * against the relays and the head, the solver of DataRecoveryHelper
+ * against a textbook elimination and with several right-hand sides, the
+ * quantization of the fixed-point mode against its error bound and the int64
+ * sums of the relays against 62 bits, and the online decoding at the head
+ * against the values the members sent, over GF(2^8) also for routes that form
+ * cycles and modulo 2^61-1 exactly for quantized values of mixed scales. Prints one line per failed check
+ * and exits with 1 if any.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "rui-crs-core.h"
+#include "rui-coding-kernel.h"
+#include "rui-chacha.h"
+#include "rui-gf256.h"
+
+namespace {
+
+int g_failures = 0;
+
+void
+Check (bool ok, const std::string &what)
+{
+  if (!ok)
+    {
+      std::cout << "FAIL: " << what << std::endl;
+      g_failures++;
+    }
+}
+
+const char *const KERNELS[] = {"scalar", "avx2", "avx512"};
+
+// RFC 8439, 2.3.2: key 00:01:..:1f, block count 1, nonce 00:00:00:09:00:00:00:4a:00:00:00:00.
+// Words 12-15 of the RFC state are the low and high words of our counter, then of our nonce.
+const uint64_t RFC_COUNTER = 1 | ((uint64_t) 0x09000000 << 32);
+const uint64_t RFC_NONCE = 0x4a000000;
+const uint32_t RFC_BLOCK[16] = {
+  0xe4e7f110, 0x15593bd1, 0x1fdd0f50, 0xc47120a3,
+  0xc7f4d1c7, 0x0368c033, 0x9aaa2204, 0x4e6cd4c3,
+  0x466482d2, 0x09aa9f07, 0x05d7c214, 0xa2028bd9,
+  0xd19c12b5, 0xb94e16de, 0xe883d0cb, 0x4e3c50a2};
+
+void
+TestChaCha (void)
+{
+  uint32_t key[8];
+  for (int w = 0; w < 8; w++)
+    {
+      key[w] = (4 * w) | (4 * w + 1) << 8 | (4 * w + 2) << 16 | (uint32_t) (4 * w + 3) << 24;
+    }
+  // 37 blocks and a partial one, so the 8 and 16 block paths and their scalar tails all run
+  const std::size_t words = 37 * 16 + 5;
+  std::vector<uint32_t> reference (words);
+  ChaChaUseKernel ("scalar");
+  ChaChaStream (key, RFC_NONCE, RFC_COUNTER, reference.data (), words, 20);
+  for (const char *name : KERNELS)
+    {
+      if (!ChaChaUseKernel (name))
+        {
+          continue;
+        }
+      std::vector<uint32_t> stream (words);
+      ChaChaStream (key, RFC_NONCE, RFC_COUNTER, stream.data (), words, 20);
+      Check (std::equal (RFC_BLOCK, RFC_BLOCK + 16, stream.begin ()), std::string ("ChaCha20 RFC 8439 block, ") + name);
+      Check (stream == reference, std::string ("ChaCha20 stream against scalar, ") + name);
+      ChaChaStream (key, 7, 0, stream.data (), words, CHACHA_ROUNDS);
+      std::vector<uint32_t> twelve (words);
+      ChaChaUseKernel ("scalar");
+      ChaChaStream (key, 7, 0, twelve.data (), words, CHACHA_ROUNDS);
+      Check (stream == twelve, std::string ("ChaCha12 stream against scalar, ") + name);
+    }
+  ChaChaUseKernel (0);
+}
+
+void
+TestCodingKernels (std::mt19937 &rng)
+{
+  std::uniform_real_distribution<double> value (-1000.0, 1000.0);
+  for (const char *name : KERNELS)
+    {
+      if (!CodingUseKernel (name))
+        {
+          continue;
+        }
+      for (std::size_t n : {0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 100, 2001})
+        {
+          std::vector<double> x (n), y (n);
+          for (std::size_t i = 0; i < n; i++)
+            {
+              x[i] = value (rng);
+              y[i] = value (rng);
+            }
+          double a = value (rng), b = value (rng);
+          std::vector<double> axpby = y, axpy = y, trunc = y;
+          CodingAxpby (axpby.data (), x.data (), a, b, n);
+          CodingAxpy (axpy.data (), x.data (), a, n);
+          CodingTruncAdd (trunc.data (), b, n);
+          bool ok = true;
+          for (std::size_t i = 0; i < n; i++)
+            {
+              // the FMA kernels round once, the scalar one twice
+              ok = ok && std::fabs (axpby[i] - (b * y[i] + a * x[i])) <= 1e-9 * (1 + std::fabs (b * y[i]) + std::fabs (a * x[i]));
+              ok = ok && std::fabs (axpy[i] - (y[i] + a * x[i])) <= 1e-9 * (1 + std::fabs (y[i]) + std::fabs (a * x[i]));
+              ok = ok && trunc[i] == std::trunc (y[i]) + b;
+            }
+          Check (ok, std::string ("coding kernels against scalar, ") + name + ", n = " + std::to_string (n));
+        }
+    }
+  CodingUseKernel (0);
+}
+
+void
+TestGfKernels (std::mt19937 &rng)
+{
+  bool ok = true;
+  for (int a = 1; a < 256; a++)
+    {
+      ok = ok && GfMul (a, GfInv (a)) == 1 && GfMul (a, 1) == a && GfMul (a, 0) == 0;
+    }
+  for (int source = 0; source < 300; source++)
+    {
+      for (int index = 0; index < 300; index++)
+        {
+          ok = ok && GfCoefficient (source, index) != 0;
+        }
+    }
+  Check (ok, "GF(2^8) inverses and non-zero coefficients");
+  std::uniform_int_distribution<int> byte (0, 255);
+  for (const char *name : KERNELS)
+    {
+      if (!GfUseKernel (name))
+        {
+          continue;
+        }
+      // below and above the length of the log table shortcut, with tails of every size
+      for (std::size_t n : {1, 31, 32, 33, 63, 64, 65, 100, 1000})
+        {
+          std::vector<uint8_t> x (n), y (n);
+          for (std::size_t i = 0; i < n; i++)
+            {
+              x[i] = byte (rng);
+              y[i] = byte (rng);
+            }
+          bool same = true;
+          for (int c : {0, 1, 2, 3, 0x53, 0xff})
+            {
+              std::vector<uint8_t> muladd = y, scale = y;
+              GfMulAdd (muladd.data (), x.data (), c, n);
+              GfScale (scale.data (), c, n);
+              for (std::size_t i = 0; i < n; i++)
+                {
+                  same = same && muladd[i] == (y[i] ^ GfMul (c, x[i])) && scale[i] == GfMul (c, y[i]);
+                }
+            }
+          Check (same, std::string ("GF(2^8) kernels against GfMul, ") + name + ", n = " + std::to_string (n));
+        }
+    }
+  GfUseKernel (0);
+}
+
+/// The scale of each contributor of a FIXED packet
+std::vector<int> ContributorScales (const CodedPacket &packet)
+{
+  std::vector<int> scales;
+  for (uint32_t v : packet.GetContributors ())
+    {
+      scales.push_back (packet.GetContributorScale (v));
+    }
+  return scales;
+}
+
+bool
+SamePacket (const CodedPacket &a, const CodedPacket &b)
+{
+  return a.GetType () == b.GetType () && a.IsInstance () == b.IsInstance () && a.IsFloat32 () == b.IsFloat32 ()
+         && a.IsFixedPoint () == b.IsFixedPoint () && a.GetContributors () == b.GetContributors ()
+         && a.GetValues () == b.GetValues () && a.GetSerializedSize () == b.GetSerializedSize ()
+         && (!a.IsFixedPoint () || (a.GetScale () == b.GetScale () && a.GetValueBytes () == b.GetValueBytes ()
+                                    && a.GetIntegers () == b.GetIntegers () && ContributorScales (a) == ContributorScales (b)));
+}
+
+/// Write packet, read it back whole and from every shorter prefix
+void
+RoundTrip (const CodedPacket &packet, const std::string &what)
+{
+  std::vector<uint8_t> data (packet.GetSerializedSize ());
+  packet.WriteBytes (data.data ());
+  CodedPacket read;
+  uint32_t size = read.ReadBytes (data.data (), data.size ());
+  Check (read.IsValid () && size == data.size () && SamePacket (packet, read), "round trip, " + what);
+  bool truncated = true;
+  for (uint32_t k = 0; k < data.size (); k++)
+    {
+      CodedPacket part;
+      part.ReadBytes (data.data (), k);
+      truncated = truncated && !part.IsValid ();
+    }
+  Check (truncated, "truncated packets rejected, " + what);
+}
+
+void
+TestPacket (void)
+{
+  CodedPacket regular;
+  RoundTrip (regular, "regular");
+
+  CodedPacket coded;
+  coded.SetType (CodedPacket::CODED);
+  coded.SetGroupSize (20);
+  coded.AddContributor (0);
+  coded.AddContributor (9);
+  coded.AddContributor (19);
+  coded.SetValues (std::vector<double> (1, -123.456));
+  RoundTrip (coded, "float64");
+
+  CodedPacket instance = coded;
+  instance.SetInstance (true);
+  instance.SetFloat32 (true);
+  instance.SetValues (std::vector<double> {0.5, -2.25, 1e6, 3});
+  RoundTrip (instance, "float32 instance");
+
+  std::vector<uint8_t> data (coded.GetSerializedSize ());
+  coded.WriteBytes (data.data ());
+  data[0] = CodedPacket::VERSION + 1;
+  CodedPacket unknown;
+  unknown.ReadBytes (data.data (), data.size ());
+  Check (!unknown.IsValid (), "unknown version rejected");
+}
+
+/// Contributor indexes past the cluster: refused by the packet and the relays, dropped by the head
+void
+TestClusterBounds (void)
+{
+  CodedPacket packet;
+  packet.SetType (CodedPacket::CODED);
+  Check (packet.SetGroupSize (12) && !packet.SetGroupSize (CodedPacket::MAX_GROUP_SIZE + 1)
+         && packet.GetBitmapBits () == 16, "cluster larger than the bitmap refused");
+  Check (packet.AddContributor (15) && !packet.AddContributor (16), "contributor outside the bitmap refused");
+  Check (!packet.FitsGroup (12) && packet.FitsGroup (16) && !packet.FitsGroup (20), "bitmap of another cluster");
+
+  // bit 14 of a cluster of 12 vehicles, as the last bitmap byte of a packet from the wire may have
+  std::vector<double> beta (12, 0.5);
+  packet.SetValues (std::vector<double> (1, 3.0));
+  Check (!RelayEncode (packet, 1, 2, beta, 1.0) && packet.GetValues ()[0] == 3.0, "relay refuses a contributor past the cluster");
+  CodedPacket fits;
+  fits.SetType (CodedPacket::ORIGINAL);
+  fits.SetGroupSize (12);
+  fits.SetValues (std::vector<double> (1, 3.0));
+  Check (!RelayEncode (fits, 12, 2, beta, 1.0) && !RelayEncode (fits, 1, -1, beta, 1.0), "relay refuses indexes past the cluster");
+
+  DataManagementHelper head (11, beta, 1);
+  head.MessageHandle (packet, 2);
+  fits.SetType (CodedPacket::CODED);
+  fits.AddContributor (2);
+  head.MessageHandle (fits, 12);
+  Check (head.GetRecoveredSet ().empty () && head.GetCoef ().empty (), "head drops packets of vehicles past the cluster");
+}
+
+/// Quantized values: the error of Quantize, the FIXED packets and their int64 sums at the relays
+void
+TestFixed (std::mt19937 &rng)
+{
+  std::vector<double> values;
+  for (int k = 0; k < 50; k++)
+    {
+      values.push_back (std::uniform_real_distribution<double> (-1000, 1000) (rng));
+    }
+  std::vector<Quantized> quantized (2);
+  std::vector<uint32_t> sizes;
+  for (int width = 0; width < 2; width++)
+    {
+      int bits = 8 << width;
+      Quantized &q = quantized[width];
+      bool bounded = Quantize (values, bits, q) && q.integers.size () == values.size ();
+      int64_t largest = 0;
+      for (std::size_t k = 0; k < q.integers.size (); k++)
+        {
+          bounded = bounded && std::fabs (std::ldexp ((double) q.integers[k], q.scale) - values[k]) <= std::ldexp (1.0, q.scale - 1);
+          largest = std::max (largest, q.integers[k] < 0 ? -q.integers[k] : q.integers[k]);
+        }
+      // the smallest scale: one less and the largest value would not fit
+      int64_t limit = ((int64_t) 1 << (bits - 1)) - 1;
+      Check (bounded && largest <= limit && 2 * largest + 1 > limit, "quantization to " + std::to_string (bits) + " bits");
+      CodedPacket packet;
+      packet.SetType (CodedPacket::ORIGINAL);
+      packet.SetInstance (true);
+      packet.SetGroupSize (20);
+      packet.SetFixedValues (q.scale, q.integers);
+      Check (packet.GetValueBytes () == width + 1, "int" + std::to_string (bits) + " entries");
+      RoundTrip (packet, "fixed " + std::to_string (bits) + " bits");
+      sizes.push_back (packet.GetSerializedSize ());
+    }
+  Check (sizes[1] - sizes[0] == values.size (), "one byte more per entry at 16 bits");
+  Quantized zeros, bad;
+  Check (Quantize (std::vector<double> (4, 0.0), 16, zeros) && zeros.scale == 0
+         && zeros.integers == std::vector<int64_t> (4, 0), "quantization of zeros");
+  Check (!Quantize (std::vector<double> {1.0, NAN}, 16, bad) && !Quantize (std::vector<double> (1, 1e300), 16, bad),
+         "quantization of values out of range refused");
+
+  // a relay with values a thousand times smaller, so a smaller scale
+  std::vector<double> beta = FixedPointBeta (std::vector<double> (20, 0.75), 8);
+  Quantized relay;
+  for (double &v : values)
+    {
+      v /= 1000;
+    }
+  Quantize (values, 16, relay);
+  CodedPacket packet;
+  packet.SetType (CodedPacket::ORIGINAL);
+  packet.SetInstance (true);
+  packet.SetGroupSize (20);
+  packet.SetFixedValues (quantized[1].scale, quantized[1].integers);
+  CodedPacket original = packet;
+  Check (!RelayEncode (packet, 7, 3, beta, 1.0) && !RelayEncodeInstance (packet, 7, 3, beta, values)
+         && SamePacket (packet, original), "relay encoding of real values refuses fixed-point packets");
+  Quantized far = relay;
+  far.scale = -60;
+  Check (!RelayEncodeQuantized (packet, 7, 3, beta, far) && SamePacket (packet, original),
+         "relay refuses sums beyond 62 bits");
+  Check (RelayEncodeQuantized (packet, 7, 3, beta, relay) && packet.GetScale () == relay.scale
+         && packet.GetContributorScale (3) == quantized[1].scale && packet.GetContributorScale (7) == relay.scale
+         && packet.GetValueBytes () > 2, "relay encoding in int64");
+  RoundTrip (packet, "fixed coded");
+}
+
+/// A round of the head with quantized values of mixed scales: the head recovers them exactly
+void
+TestFixedHead (std::mt19937 &rng)
+{
+  const int size = 12, entries = 6;
+  std::vector<double> real_beta;
+  for (int i = 0; i < size; i++)
+    {
+      real_beta.push_back (std::uniform_real_distribution<double> (0.1, 1.0) (rng));
+    }
+  std::vector<double> beta = FixedPointBeta (real_beta, 8);
+  for (int bits = 8; bits <= 16; bits += 8)
+    {
+      std::vector<Quantized> quantized (size);
+      for (int i = 0; i < size; i++)
+        {
+          std::vector<double> masked (entries);
+          for (double &v : masked)
+            {
+              // scales up to 12 apart across the vehicles
+              v = std::ldexp (MaskObservation (std::uniform_int_distribution<int> (50, 70) (rng), i, size) + 0.37, 3 * (i % 5));
+            }
+          Quantize (masked, bits, quantized[i]);
+        }
+      DataManagementHelper head (size - 1, beta, entries);
+      for (int source = 1; source < size; source++)
+        {
+          CodedPacket packet;
+          packet.SetType (CodedPacket::ORIGINAL);
+          packet.SetInstance (true);
+          packet.SetGroupSize (size);
+          packet.SetFixedValues (quantized[source].scale, quantized[source].integers);
+          for (int relay = source - 1; relay > 0 && relay >= source - source % 3; relay--)
+            {
+              Check (RelayEncodeQuantized (packet, relay, source, beta, quantized[relay]), "quantized relay encoding");
+            }
+          std::vector<uint8_t> data (packet.GetSerializedSize ());
+          packet.WriteBytes (data.data ());
+          CodedPacket received;
+          received.ReadBytes (data.data (), data.size ());
+          head.MessageHandleInstance (received, source);
+        }
+      bool ok = head.IsRecoveryComplete ();
+      for (int v : head.GetRecoveredSet ())
+        {
+          std::vector<double> values = head.GetRecoveredValues (v);
+          for (int e = 0; e < entries && v > 0; e++)
+            {
+              ok = ok && values[e] == std::ldexp ((double) quantized[v].integers[e], quantized[v].scale);
+            }
+        }
+      Check (ok, "exact decoding of " + std::to_string (bits) + "-bit values at the head");
+    }
+}
+
+/// Textbook Gaussian elimination with partial pivoting, for a regular system
+std::vector<double>
+Solve (std::vector<std::vector<double> > a)
+{
+  int n = a.size ();
+  for (int col = 0; col < n; col++)
+    {
+      int best = col;
+      for (int i = col + 1; i < n; i++)
+        {
+          if (std::fabs (a[i][col]) > std::fabs (a[best][col]))
+            {
+              best = i;
+            }
+        }
+      std::swap (a[col], a[best]);
+      for (int i = col + 1; i < n; i++)
+        {
+          double f = a[i][col] / a[col][col];
+          for (int k = col; k <= n; k++)
+            {
+              a[i][k] -= f * a[col][k];
+            }
+        }
+    }
+  std::vector<double> x (n);
+  for (int i = n - 1; i >= 0; i--)
+    {
+      double sum = a[i][n];
+      for (int k = i + 1; k < n; k++)
+        {
+          sum -= a[i][k] * x[k];
+        }
+      x[i] = sum / a[i][i];
+    }
+  return x;
+}
+
+/// n functions of n vehicles with random betas and integer values x[e] for each of the
+/// entries: coef holds the rows with the right-hand side of the first entry, rhs all of them
+void
+RandomSystem (std::mt19937 &rng, int n, int entries, std::vector<std::vector<double> > &x,
+              std::vector<std::vector<double> > &coef, std::vector<double> &rhs)
+{
+  std::uniform_real_distribution<double> value (0.1, 1.0);
+  x.assign (entries, std::vector<double> (n));
+  for (std::vector<double> &column : x)
+    {
+      for (double &v : column)
+        {
+          v = std::uniform_int_distribution<int> (-1000, 1000) (rng);
+        }
+    }
+  coef.assign (n, std::vector<double> (n + 1));
+  rhs.clear ();
+  for (int i = 0; i < n; i++)
+    {
+      for (int k = 0; k < n; k++)
+        {
+          coef[i][k] = value (rng);
+        }
+      for (int e = 0; e < entries; e++)
+        {
+          double sum = 0;
+          for (int k = 0; k < n; k++)
+            {
+              sum += coef[i][k] * x[e][k];
+            }
+          rhs.push_back (sum);
+          if (e == 0)
+            {
+              coef[i][n] = sum;
+            }
+        }
+    }
+}
+
+void
+TestSolver (std::mt19937 &rng)
+{
+  const int n = 8;
+  std::vector<std::vector<double> > x, coef;
+  std::vector<double> rhs;
+  RandomSystem (rng, n, 1, x, coef, rhs);
+  std::vector<double> reference = Solve (coef);
+
+  DataRecoveryHelper single;
+  single.SetParameters (n, n, coef);
+  single.pc ();
+  std::vector<double> s = single.GetResults ();
+  bool ok = single.GetRank () == n;
+  for (int k = 0; k < n; k++)
+    {
+      ok = ok && single.GetSolved ()[k] && std::fabs (s[k] - reference[k]) < 1e-6 && std::fabs (s[k] - x[0][k]) < 1e-6;
+    }
+  Check (ok, "DataRecoveryHelper against Gaussian elimination");
+
+  // the last vehicle only appears in the last function, so its pivot is found last
+  std::vector<std::vector<double> > late (coef.begin (), coef.end () - 1);
+  for (std::vector<double> &row : late)
+    {
+      row[n] -= row[n - 1] * x[0][n - 1];
+      row[n - 1] = 0;
+    }
+  late.push_back (std::vector<double> (n + 1, 0));
+  late.back ()[0] = 1;
+  late.back ()[n - 1] = 1;
+  late.back ()[n] = x[0][0] + 5;
+  DataRecoveryHelper last;
+  last.SetParameters (n, n, late);
+  last.pc ();
+  s = last.GetResults ();
+  ok = last.GetRank () == n;
+  for (int k = 0; k < n; k++)
+    {
+      ok = ok && last.GetSolved ()[k] && std::fabs (s[k] - (k == n - 1 ? 5 : x[0][k])) < 1e-6;
+    }
+  Check (ok, "DataRecoveryHelper with a late pivot");
+}
+
+void
+TestBatchSolver (std::mt19937 &rng)
+{
+  const int n = 8, entries = 5;
+  std::vector<std::vector<double> > x, coef;
+  std::vector<double> rhs;
+  RandomSystem (rng, n, entries, x, coef, rhs);
+  DataRecoveryHelper batch;
+  batch.SetParametersBatch (n, n, coef, rhs, entries);
+  batch.pc ();
+  std::vector<std::vector<double> > sb = batch.GetResultsBatch ();
+  bool ok = batch.GetRank () == n;
+  for (int e = 0; e < entries; e++)
+    {
+      for (int k = 0; k < n; k++)
+        {
+          ok = ok && std::fabs (sb[e][k] - x[e][k]) < 1e-6;
+        }
+    }
+  Check (ok, "DataRecoveryHelper batch right-hand sides");
+}
+
+/// A round of the head: every member sends its masked entries, some through relays
+void
+TestHead (std::mt19937 &rng)
+{
+  const int size = 12, entries = 6;
+  std::vector<double> beta;
+  for (int i = 0; i < size; i++)
+    {
+      beta.push_back (std::uniform_real_distribution<double> (0.1, 1.0) (rng));
+    }
+  std::vector<std::vector<double> > masked (size, std::vector<double> (entries));
+  for (int i = 0; i < size; i++)
+    {
+      for (double &v : masked[i])
+        {
+          v = MaskObservation (std::uniform_int_distribution<int> (50, 70) (rng), i, size);
+        }
+    }
+  DataManagementHelper head (size - 1, beta, entries);
+  for (int source = 1; source < size; source++)
+    {
+      CodedPacket packet;
+      packet.SetType (CodedPacket::ORIGINAL);
+      packet.SetInstance (true);
+      packet.SetGroupSize (size);
+      packet.SetValues (masked[source]);
+      // a chain of relays towards the head, source -> source-1 -> ..., so each packet
+      // adds one new vehicle to the ones before it and the system is triangular
+      for (int relay = source - 1; relay > 0 && relay >= source - source % 3; relay--)
+        {
+          Check (RelayEncodeInstance (packet, relay, source, beta, masked[relay]), "relay encoding");
+        }
+      std::vector<uint8_t> data (packet.GetSerializedSize ());
+      packet.WriteBytes (data.data ());
+      CodedPacket received;
+      received.ReadBytes (data.data (), data.size ());
+      head.MessageHandleInstance (received, source);
+    }
+  bool ok = head.IsRecoveryComplete ();
+  for (int v : head.GetRecoveredSet ())
+    {
+      std::vector<double> values = head.GetRecoveredValues (v);
+      for (int e = 0; e < entries && v > 0; e++)
+        {
+          ok = ok && std::fabs (values[e] - masked[v][e]) < 1e-6;
+        }
+    }
+  Check (ok, "online decoding at the head");
+}
+
+/// A round over GF(2^8): each route is a source and the relays its packet goes through,
+/// the head is the last index and does not send. Returns the vehicles the head recovers
+/// with the values they sent.
+int
+FieldRound (const std::vector<std::vector<int> > &routes, int size, int entries, bool contributions)
+{
+  std::vector<std::vector<double> > masked (size, std::vector<double> (entries));
+  for (int i = 0; i < size; i++)
+    {
+      for (int e = 0; e < entries; e++)
+        {
+          masked[i][e] = MaskObservation (60 + (i * 7 + e) % 11, i, size);
+        }
+    }
+  const uint8_t bytes = 2;
+  DataManagementHelper head (size - 1, std::vector<double> (size, 1), entries);
+  for (const std::vector<int> &route : routes)
+    {
+      CodedPacket packet;
+      packet.SetType (CodedPacket::ORIGINAL);
+      packet.SetInstance (true);
+      packet.SetGroupSize (size);
+      Check (packet.SetFieldValues (masked[route[0]], 0, bytes), "field values");
+      for (std::size_t hop = 1; hop < route.size (); hop++)
+        {
+          bool coded = contributions
+                       ? RelayEncodeInstance (packet, route[hop], route[0], RelayFieldContribution (masked[route[hop]], bytes))
+                       : RelayEncodeInstance (packet, route[hop], route[0], std::vector<double> (), masked[route[hop]]);
+          Check (coded, "field relay encoding");
+        }
+      std::vector<uint8_t> data (packet.GetSerializedSize ());
+      packet.WriteBytes (data.data ());
+      CodedPacket received;
+      received.ReadBytes (data.data (), data.size ());
+      head.MessageHandleInstance (received, route[0]);
+    }
+  int recovered = 0;
+  for (int v : head.GetRecoveredSet ())
+    {
+      recovered += head.GetRecoveredValues (v) == masked[v];
+    }
+  return recovered;
+}
+
+void
+TestFieldHead (std::mt19937 &rng)
+{
+  // a cycle of routes 0 -> 1, 1 -> 2, 2 -> 0 and 3 sending directly: with one coefficient per
+  // vehicle the three coded packets of the odd cycle add up to 0 in characteristic 2
+  std::vector<std::vector<int> > cycle = {{0, 1}, {1, 2}, {2, 0}, {3}};
+  Check (FieldRound (cycle, 5, 3, false) == 4, "GF(2^8) decoding of an odd cycle of routes");
+  Check (FieldRound (cycle, 5, 3, true) == 4, "GF(2^8) decoding of an odd cycle of routes, contributions");
+  std::vector<std::vector<int> > even = {{0, 1}, {1, 2}, {2, 3}, {3, 0}};
+  Check (FieldRound (even, 5, 40, true) == 4, "GF(2^8) decoding of an even cycle of routes");
+
+  // every member through 0 to 3 random relays, the head recovers all or almost all
+  const int size = 30;
+  int complete = 0;
+  for (int trial = 0; trial < 20; trial++)
+    {
+      std::vector<std::vector<int> > routes;
+      for (int source = 0; source < size - 1; source++)
+        {
+          std::vector<int> route (1, source);
+          int hops = std::uniform_int_distribution<int> (0, 3) (rng);
+          for (int hop = 0; hop < hops; hop++)
+            {
+              int relay = std::uniform_int_distribution<int> (0, size - 2) (rng);
+              if (std::find (route.begin (), route.end (), relay) == route.end ())
+                {
+                  route.push_back (relay);
+                }
+            }
+          routes.push_back (route);
+        }
+      complete += FieldRound (routes, size, 4, trial % 2) == size - 1;
+    }
+  // a random square system over GF(2^8) is regular with probability about 0.996
+  Check (complete >= 18, "GF(2^8) decoding of random routes, " + std::to_string (complete) + " of 20 complete");
+}
+
+void
+TestMasks (void)
+{
+  // the masks of a cluster cancel in every entry of the sum
+  const int size = 9, entries = 40;
+  std::vector<double> sum (entries, 0);
+  PairwiseMasker masker (42, size, 20);
+  for (int i = 0; i < size; i++)
+    {
+      std::vector<double> values (entries, 0);
+      masker.Mask (i, values.data (), entries);
+      for (int e = 0; e < entries; e++)
+        {
+          sum[e] += values[e];
+        }
+    }
+  Check (sum == std::vector<double> (entries, 0), "pairwise masks cancel");
+  int total = 0;
+  for (int i = 0; i < size; i++)
+    {
+      total += MaskObservation (0, i, size);
+    }
+  Check (total == 0, "masks of the paper cancel");
+}
+
+} // namespace
+
+int
+main (void)
+{
+  std::mt19937 rng (1);
+  TestChaCha ();
+  TestCodingKernels (rng);
+  TestGfKernels (rng);
+  TestPacket ();
+  TestClusterBounds ();
+  TestFixed (rng);
+  TestSolver (rng);
+  TestBatchSolver (rng);
+  TestHead (rng);
+  TestFieldHead (rng);
+  TestFixedHead (rng);
+  TestMasks ();
+  std::cout << (g_failures == 0 ? "all checks passed" : "checks failed: " + std::to_string (g_failures))
+            << " (kernels " << ChaChaKernelName () << ", " << CodingKernelName () << ", " << GfKernelName () << ")"
+            << std::endl;
+  return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Rui: converts an ns-2 mobility trace (e.g. trace_acosta_rui.tcl exported by SUMO)
+ * to the binary trace read by BinaryMobilityHelper (see rui-mobility-trace.h).
+ * Run it again whenever the ns-2 trace changes.
+ *
+ *   ./waf --run "Rui_trace_convert --input=tracefile/trace_acosta_rui.tcl"
+ *
+ * The output defaults to the input with the extension replaced by .bin, which is
+ * where vanet-sumo-Rui-real_scenario_acosta.cc and Rui_RSU_vehicle_real.cc look for it.
+ */
+
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/rui-mobility-trace.h"
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string input = "tracefile/trace_acosta_rui.tcl";
+  std::string output = "";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("input", "ns-2 mobility trace", input);
+  cmd.AddValue ("output", "binary mobility trace, the input with the .bin extension if empty", output);
+  cmd.Parse (argc, argv);
+
+  if (output.empty ())
+    {
+      output = BinaryMobilityTraceFor (input);
+    }
+  if (!ConvertNs2MobilityTrace (input, output))
+    {
+      std::cerr << "Cannot convert " << input << " to " << output << std::endl;
+      return 1;
+    }
+
+  MobilityTraceFile trace;
+  trace.Open (output);
+  uint64_t waypoints = 0;
+  for (uint32_t node = 0; node < trace.GetNodeCount (); node++)
+    {
+      uint64_t count = 0;
+      trace.GetWaypoints (node, count);
+      waypoints += count;
+    }
+  std::cout << output << ": " << trace.GetNodeCount () << " nodes, " << waypoints << " waypoints" << std::endl;
+  return 0;
+}
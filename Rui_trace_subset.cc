@@ -0,0 +1,118 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Rui: keeps only the vehicles of a mobility trace that come within range of the
+ * cluster(s) during a time window, so the realistic scenario simulates the cluster
+ * and the vehicles that can interfere with it instead of the 1004 vehicles of the trace.
+ *
+ *   ./waf --run "Rui_trace_subset --input=tracefile/trace_acosta_rui.tcl --clusterConfig=cluster.txt --stop=20"
+ *
+ * Writes the renumbered trace (<input>_subset.bin by default) and a cluster file with
+ * the node IDs of the subset (<output>.cluster), to run with
+ *
+ *   ./waf --run "vanet-sumo-Rui-real_scenario_acosta --mobilityTrace=<output> --clusterConfig=<output>.cluster"
+ */
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include "ns3/core-module.h"
+#include "ns3/rui-vehicle-beta.h"
+#include "ns3/rui-cluster-config.h"
+#include "ns3/rui-mobility-trace.h"
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string input = "tracefile/trace_acosta_rui.tcl";
+  std::string output = "";
+  double start = 0;
+  double stop = 20; //the simulation time of the realistic scenario
+  double range = 100; //MaxRange of the loss model used in the realistic scenario
+  double step = 0.1;
+
+  ClusterConfig cluster;
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("input", "ns-2 or binary mobility trace", input);
+  cmd.AddValue ("output", "binary trace of the subset, <input>_subset.bin if empty", output);
+  cmd.AddValue ("start", "start of the time window (s)", start);
+  cmd.AddValue ("stop", "end of the time window (s), the later waypoints are dropped", stop);
+  cmd.AddValue ("range", "interference range (m)", range);
+  cmd.AddValue ("step", "time between two checks of the distances (s)", step);
+  cluster.AddCommandLineValues (cmd);
+  cmd.Parse (argc, argv);
+  cluster.Apply ();
+
+  std::string binaryFile = FindBinaryMobilityTrace (input);
+  if (binaryFile.empty ())
+    {
+      binaryFile = BinaryMobilityTraceFor (input);
+      if (!ConvertNs2MobilityTrace (input, binaryFile))
+        {
+          std::cerr << "Cannot convert " << input << std::endl;
+          return 1;
+        }
+    }
+  if (output.empty ())
+    {
+      output = binaryFile.substr (0, binaryFile.size () - 4) + "_subset.bin";
+    }
+
+  MobilityTraceFile trace;
+  if (!trace.Open (binaryFile))
+    {
+      std::cerr << "Cannot read " << binaryFile << std::endl;
+      return 1;
+    }
+  std::vector<int> kept;
+  if (!SubsetMobilityTrace (trace, cluster_list, start, stop, range, step, output, kept))
+    {
+      std::cerr << "Cannot write " << output << std::endl;
+      return 1;
+    }
+
+  //the same clusters with the node IDs of the subset
+  std::map<int, int> new_id;
+  for (uint32_t i = 0; i < kept.size (); i++)
+    {
+      new_id[kept[i]] = i;
+    }
+  std::ofstream clusterFile (output + ".cluster");
+  clusterFile.precision (17);
+  clusterFile << "# made by Rui_trace_subset from " << input << ", " << start << " s to " << stop << " s, range " << range << " m\n";
+  clusterFile << "size " << group_size << "\nhead " << head_node << "\nentries " << num_entries << "\nbeta";
+  for (double beta : vehicle_beta)
+    {
+      clusterFile << " " << beta;
+    }
+  clusterFile << "\nobser";
+  for (double obser : vehicle_obser)
+    {
+      clusterFile << " " << obser;
+    }
+  clusterFile << "\n";
+  for (const std::vector<int> &nodes : cluster_list)
+    {
+      clusterFile << "nodes";
+      for (int node : nodes)
+        {
+          if (new_id.count (node) == 0)
+            {
+              std::cerr << "Vehicle " << node << " is not in " << input << std::endl;
+              return 1;
+            }
+          clusterFile << " " << new_id[node];
+        }
+      clusterFile << "\n";
+    }
+  clusterFile << "# vehicles of " << input << " by node ID of the subset:";
+  for (int node : kept)
+    {
+      clusterFile << " " << node;
+    }
+  clusterFile << "\n";
+
+  std::cout << output << ": " << kept.size () << " of " << trace.GetNodeCount () << " vehicles, clusters in " << output << ".cluster" << std::endl;
+  return 0;
+}
@@ -41,6 +41,7 @@
 #include "ns3/wifi-mac-queue-item.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
+#include "ns3/global-value.h"
 #include <algorithm>
 #include <limits>
 
@@ -50,12 +51,10 @@
 #include <map>
 #include "ns3/rui-vehicle-beta.h" 
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-coded-packet.h"
+#include "ns3/rui-crs-core.h"
+#include "ns3/rui-crs-context.h"
 using namespace std;
-map<ns3::Ipv4Address, int> address_to_id;
-vector<double> mask_obser;
-vector<vector<double>> mask_obser_instance;
-map<int, int> stat_network_coding_time;
-map<int, int> node_ID_to_index; 
 
 
 namespace ns3 {
@@ -602,128 +601,152 @@ RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
 }
 
 
-Ptr<Packet> ModifyPacketContent (UdpHeader udpHeader, string s, int route_id, int source_id) 
+//Rui: network coding at a router, done in place on the values of the received packet
+//by the coding core (rui-crs-core.h). Returns false if the packet does not look like a
+//CRS packet of this cluster, or if a fixed-point sum would leave 62 bits. The masks
+//are those of the context of the simulation, quantized for the fixed-point packets. The
+//contributor bitmap comes from the wire, so it must be that of this cluster before the
+//betas are indexed by it.
+bool ModifyPacketContent (const CrsContext &crs, CodedPacketHeader &crsHeader, int route_index, int source_index) 
 {
-  ostringstream msg; 
-
-  int route_index = node_ID_to_index.at(route_id);
-  int source_index = node_ID_to_index.at(source_id);
+  if (!crsHeader.FitsGroup (vehicle_beta.size ()))
+  {
+    return false;
+  }
+  if (crsHeader.IsFixedPoint ())
+  {
+    return route_index < (int) crs.quantized_obser.size ()
+           && RelayEncodeQuantized (crsHeader, route_index, source_index, vehicle_beta, crs.quantized_obser[route_index]);
+  }
+  return RelayEncode (crsHeader, route_index, source_index, vehicle_beta, crs.mask_obser[route_index]);
+}
 
-  vector<string> res = split(s, "|");
-  if (res.size() == 1) //original packet, I am the first router
+bool ModifyPacketContent_instance (const CrsContext &crs, CodedPacketHeader &crsHeader, int route_index, int source_index) 
+{
+  if (!crsHeader.FitsGroup (vehicle_beta.size ()))
   {
-    double a_test = vehicle_beta[source_index] * stod(res[0]);
-    double b_test = vehicle_beta[route_index] * mask_obser[route_index];
-    double net_cod_value = a_test + b_test;
-    msg << route_id << "+" << source_id << '|' << net_cod_value ;//<< '\0';
+    return false;
   }
-  else if (res.size() == 2)//already forwarded by others
+  bool coded;
+  if (crsHeader.IsFixedPoint ())
   {
-    double net_cod_value = vehicle_beta[route_index] * mask_obser[route_index] + stod(res[1]);
-    msg << route_id << "+" << res[0] << '|' << net_cod_value;
+    coded = route_index < (int) crs.quantized_obser.size ()
+            && RelayEncodeQuantized (crsHeader, route_index, source_index, vehicle_beta, crs.quantized_obser[route_index]);
   }
-  else //error
+  else if (crsHeader.IsField () && route_index < (int) crs.relay_field_contribution_instance.size ())
   {
-    msg << "?" << s ;//<< '\0';
+    coded = RelayEncodeInstance (crsHeader, route_index, source_index, crs.relay_field_contribution_instance[route_index]);
   }
-
- 
-  uint16_t packetSize = msg.str().length()+1;
- 
-  Ptr<Packet> new_packet = Create<Packet> ((uint8_t*) msg.str().c_str(), packetSize);
-  //cout << "added header: " << udpHeader << endl;
-  new_packet -> AddHeader (udpHeader);
-
-  return new_packet;
+  else if (!crsHeader.IsField () && route_index < (int) crs.relay_contribution_instance.size ())
+  {
+    coded = RelayEncodeInstance (crsHeader, route_index, source_index, vehicle_beta[source_index], crs.relay_contribution_instance[route_index]);
+  }
+  else
+  {
+    coded = RelayEncodeInstance (crsHeader, route_index, source_index, vehicle_beta, crs.mask_obser_instance[route_index]);
+  }
+  if (!coded)
+  {
+    return false;
+  }
+  NS_LOG_INFO("content:"<< crsHeader);
+  return true;
 }
 
-Ptr<Packet> ModifyPacketContent_instance (UdpHeader udpHeader, string s, int route_id, int source_id) 
+//Rui: the paper's relays sent the received packet and then the coded one. By default a relay
+//now only sends the coded packet; set --CrsForwardUncodedCopy=true to reproduce the paper.
+static GlobalValue g_crsForwardUncodedCopy ("CrsForwardUncodedCopy",
+                                            "Relays also forward the uncoded packet before the coded one",
+                                            BooleanValue (false),
+                                            MakeBooleanChecker ());
+
+//Rui: encode a CRS data packet at a router. Returns 0 if p is not a packet to encode
+//(AODV/regular packets, packets of other applications, malformed payloads). origin and
+//destination are those of the IPv4 header, which the UDP checksum covers.
+Ptr<Packet> EncodeAtRelay (CrsContext &crs, Ptr<const Packet> p, Ipv4Address route_addr, Ipv4Address origin, Ipv4Address destination)
 {
-  ostringstream msg; 
-
-  vector<string> res = split(s, "|");
-  //cout<<"received string:"<<s<<endl;
-  //cout<<"res.size():"<<res.size()<<endl;
-  //vector<double> net_cod_value;
-
-  int route_index = node_ID_to_index.at(route_id);
-  int source_index = node_ID_to_index.at(source_id);
-
-  if (res.size() == num_entries+1) //original packet, I am the first router looks like IT|A|B|C|D
+  UdpHeader udpHeader_checkport;
+  p->PeekHeader (udpHeader_checkport);
+  if (udpHeader_checkport.GetSourcePort () != 9)
   {
-    double a_test = 0;
-    double b_test = 0;
+    return 0;
+  }
 
-    msg << "IT|"<<route_id << "+" << source_id; // IT|node1+node2
+  auto begin = chrono::high_resolution_clock::now();
+
+  // p is const and may be shared with the uncoded copy (g_crsForwardUncodedCopy) and the
+  // trace sinks, and ns-3 gives no write access to the bytes of a packet: a Packet can only
+  // be changed through its headers and trailers, and its Buffer copies its bytes on the
+  // first such write once shared. So the coded packet is a Copy(), which only shares the
+  // buffer and keeps the tags (e.g. TimestampTag), and the values are changed by removing
+  // and adding the CRS header.
+  Ptr<Packet> pkt_nc = p->Copy();
+  UdpHeader udpHeader;
+  pkt_nc->RemoveHeader (udpHeader);
+  CodedPacketHeader crsHeader;
+  pkt_nc->RemoveHeader (crsHeader);
+  if (!crsHeader.IsValid () || crsHeader.GetType () == CodedPacketHeader::REGULAR)
+  {
+    return 0;
+  }
 
-    for(int entries = 0; entries < num_entries; entries ++)
-    {
-      a_test = vehicle_beta[source_index] * stod(res[1+entries]);
-      b_test = vehicle_beta[route_index] * mask_obser_instance[route_index][entries];
-      //net_cod_value.push_back(a_test + b_test);
-      msg << "|" << a_test + b_test;// IT|node1+node2|A|B|C|D
-      //cout<<"entires:"<<entries<<"a_test"<< a_test<<"b_test"<< b_test<<endl;
-    }
-    msg<< '\0';
-    //cout<<"Now msg:"<<msg.str()<<endl;
+  // packets from or through vehicles the context does not know pass unchanged
+  int route_id = crs.address_to_id.Find(route_addr.Get ());
+  int source_id = crs.address_to_id.Find(origin.Get ());
+  if (route_id < 0 || source_id < 0)
+  {
+    return 0;
   }
-  else if (res.size() == num_entries+2)//already forwarded by others looks like IT|node1+node2+node3|A|B|C|D
+  if (!crs.node_ID_to_cluster.Empty ())
   {
-    
-    msg << "IT|"<<route_id << "+" << res[1]; // IT|node1+node2
-    for(int entries = 0; entries < num_entries; entries ++)
+    // a relay only codes for its own cluster, the packets of other clusters and of vehicles
+    // outside any cluster pass unchanged
+    int route_cluster = crs.node_ID_to_cluster.Find(route_id);
+    int source_cluster = crs.node_ID_to_cluster.Find(source_id);
+    if (route_cluster < 0 || source_cluster < 0 || route_cluster != source_cluster)
     {
-      //net_cod_value.push_back(vehicle_beta[route_id]* mask_obser_instance[route_id][entries] + stod(res[2+entries]););
-      msg << "|" << vehicle_beta[route_index]* mask_obser_instance[route_index][entries] + stod(res[2+entries]);// IT|node1+node2|A|B|C|D
+      return 0;
     }
-    msg<< '\0';
   }
-  else //error
+
+  int route_index = crs.node_ID_to_index.Find(route_id);
+  int source_index = crs.node_ID_to_index.Find(source_id);
+  if (route_index < 0 || source_index < 0)
   {
-    //cout<<"Size error"<<endl;
-    msg << "?" << s ;//<< '\0';
-    NS_LOG_DEBUG("Error of res.size()!"); 
+    return 0;
   }
 
-  //msg << route->GetSource () << "+"<< s ;//<< '\0';
-  uint16_t packetSize = msg.str().length()+1;
-  //cout << "packetSize: " << packetSize << "content:"<< msg.str()<<endl;
-  NS_LOG_INFO("packetSize: " << packetSize << "content:"<< msg.str());
-  Ptr<Packet> new_packet = Create<Packet> ((uint8_t*) msg.str().c_str(), packetSize);
-  //cout << "added header: " << udpHeader << endl;
-  //cout<< "Treated as instance: new packet size at router:"<<packetSize <<endl;
-  new_packet -> AddHeader (udpHeader);
-
-  return new_packet;
-}
-
-Ptr<Packet> PrintPacketContent (string s,  UdpHeader udpHeader, int route_id, int source_id, int instance) 
-{
-
-  UdpHeader new_udpHeader;
-  new_udpHeader.SetDestinationPort(udpHeader.GetDestinationPort());
-  new_udpHeader.SetSourcePort(udpHeader.GetSourcePort());
-
-  Ptr<Packet> new_packet;
-  if( instance == 1)
+  bool coded;
+  if (crsHeader.IsInstance ())
   {
     NS_LOG_LOGIC("Plan to forward an Instance packet!");
-    new_packet = ModifyPacketContent_instance (new_udpHeader, s, route_id, source_id);
-
+    coded = ModifyPacketContent_instance (crs, crsHeader, route_index, source_index);
   }
   else
   {
-    new_packet = ModifyPacketContent (new_udpHeader, s, route_id, source_id);
+    coded = ModifyPacketContent (crs, crsHeader, route_index, source_index);
+  }
+  if (!coded)
+  {
+    return 0;
   }
-  Ptr<Packet> pkt_nc2 = new_packet->Copy();
-  UdpHeader udpHeader2;
-  pkt_nc2->RemoveHeader (udpHeader2);
-  return new_packet;
-
-}
-
 
+  // the deserialized UDP header would write back the length and the checksum of the
+  // packet as it arrived, so both are computed again for the coded payload
+  pkt_nc->AddHeader (crsHeader);
+  udpHeader.ForcePayloadSize (pkt_nc->GetSize () + udpHeader.GetSerializedSize ());
+  udpHeader.ForceChecksum (0);
+  if (Node::ChecksumEnabled ())
+  {
+    udpHeader.EnableChecksums ();
+    udpHeader.InitializeChecksum (origin, destination, UdpL4Protocol::PROT_NUMBER);
+  }
+  pkt_nc->AddHeader (udpHeader);
 
+  auto end = chrono::high_resolution_clock::now();
+  crs.stat_network_coding_time[route_id] = crs.stat_network_coding_time[route_id]+chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
+  return pkt_nc;
+}
 
 
 
@@ -764,53 +787,37 @@ RoutingProtocol::Forwarding (Ptr<const Packet> p, const Ipv4Header & header,
           m_nb.Update (route->GetGateway (), m_activeRouteTimeout);
           m_nb.Update (toOrigin.GetNextHop (), m_activeRouteTimeout);
 
-          ucb (route, p, header);
-
-          UdpHeader udpHeader_checkport;
-          p->PeekHeader (udpHeader_checkport);
-
-
-          auto begin = chrono::high_resolution_clock::now();
-
-          Ptr<Packet> pkt_nc = p->Copy();
-          UdpHeader udpHeader;
-          pkt_nc->RemoveHeader (udpHeader);
-          uint8_t *buffer = new uint8_t[pkt_nc->GetSize ()];
-          pkt_nc->CopyData(buffer, pkt_nc->GetSize ());//uint16_t size =
-          string s = string(buffer, buffer+pkt_nc->GetSize ());
-          vector<string> ss = split(s, "|");
-
-
-          if(ss[0]!="RP" && udpHeader_checkport.GetSourcePort()==9)
+          Ptr<Node> node = m_ipv4->GetObject<Node> ();
+          Ptr<CrsContext> crs = CrsContext::Get (node);
+          if (crs == 0) //not a CRS simulation
           {
+            ucb (route, p, header);
+            return true;
+          }
+          int route_id = node->GetId ();
+
+          BooleanValue forwardUncodedCopy;
+          g_crsForwardUncodedCopy.GetValue (forwardUncodedCopy);
+          if (forwardUncodedCopy.Get ())
+          {
+            ucb (route, p, header);
+            crs->stat_relay_frames[route_id]++;
+          }
 
-
-            int route_id = address_to_id.at(route->GetSource());
-
-            int source_id = address_to_id.at(origin);
-
-            int route_index = node_ID_to_index.at(route_id);
-
-            
-            int instance = 0;
-            if(ss[0]=="IT")
-            {
-              instance = 1;
-            }
-            Ptr<Packet> new_packet = PrintPacketContent (s, udpHeader, route_id, source_id, instance);
-
-    
-            Ipv4Header new_ipv4header;
-            UdpHeader udpHeader_peeked;
-            new_packet->PeekHeader (udpHeader_peeked);
-            new_ipv4header = header; 
-            new_ipv4header.SetPayloadSize(udpHeader_peeked.GetPayloadSize()+udpHeader_peeked.GetSerializedSize());
-
-            auto end = chrono::high_resolution_clock::now();
-            stat_network_coding_time[route_index] = stat_network_coding_time[route_index]+chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
-
-            ucb (route, new_packet, new_ipv4header); 
-            }
+          Ptr<Packet> coded_packet = EncodeAtRelay (*crs, p, route->GetSource (), origin, header.GetDestination ());
+          if (coded_packet != 0)
+          {
+            // the IPv4 length follows the coded payload
+            Ipv4Header coded_header = header;
+            coded_header.SetPayloadSize (coded_packet->GetSize ());
+            ucb (route, coded_packet, coded_header);
+            crs->stat_relay_frames[route_id]++;
+          }
+          else if (!forwardUncodedCopy.Get ())
+          {
+            ucb (route, p, header);
+            crs->stat_relay_frames[route_id]++;
+          }
           return true; //regular packet
         }
       else
@@ -19,7 +19,8 @@
 //
 
 // Rui: to control the actual packet loss rate, 
-// we drop additional packets with a constant drop rate (set by rui-vehicle-beta.h) in the IP layer
+// we drop additional packets with a constant drop rate (set by rui-vehicle-beta.h) in the IP layer,
+// drawn from the IpDropModel (rui-crs-context.h) of the node
 
 #include "ns3/packet.h"
 #include "ns3/log.h"
@@ -47,8 +48,7 @@
 #include "ipv4-interface.h"
 #include "ipv4-raw-socket-impl.h"
 
-#include <random>
-#include "ns3/rui-vehicle-beta.h"
+#include "ns3/rui-crs-context.h"
 using namespace std;
 
 namespace ns3 {
@@ -246,6 +246,11 @@ Ipv4L3Protocol::SetNode (Ptr<Node> node)
 {
   NS_LOG_FUNCTION (this << node);
   m_node = node;
+  // Rui: the drops of this node, its own random stream
+  if (m_node->GetObject<IpDropModel> () == 0)
+    {
+      m_node->AggregateObject (CreateObject<IpDropModel> ());
+    }
   // Add a LoopbackNetDevice if needed, and an Ipv4Interface on top of it
   SetupLoopback ();
 }
@@ -584,11 +589,12 @@ Ipv4L3Protocol::Receive ( Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t p
   //---------------rui------------------start
     ////std::cout<<"******IPLAYER******"<< "Packet from " << from << " received on node " << m_node->GetId ()<<std::endl;//Rui
 
-  double rand_drop = (double)dis(gen)/100.0;
-
-  if(rand_drop < error_rate)//drop Rui
+  // the stream of this node, aggregated by SetNode, so the drops follow --RngSeed/--RngRun
+  // and do not depend on the other stacks of the process
+  Ptr<IpDropModel> drop = m_node->GetObject<IpDropModel> ();
+  if (drop != 0 && drop->Drop ())//drop Rui
   {
-    NS_LOG_INFO( "[DROP] " << rand_drop << " from node "<< from << " received by "<< m_node->GetId ());
+    NS_LOG_INFO( "[DROP] from node "<< from << " received by "<< m_node->GetId ());
     return;
   }
   //---------------rui------------------end
@@ -0,0 +1,306 @@
+#include <cstring>
+#include "rui-chacha.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RUI_CHACHA_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*BlocksFunction) (const uint32_t key[8], uint64_t nonce, uint64_t counter,
+                                uint32_t *out, std::size_t blocks, int rounds);
+
+const uint32_t SIGMA[4] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574}; // "expand 32-byte k"
+
+void
+InitState (uint32_t state[16], const uint32_t key[8], uint64_t nonce, uint64_t counter)
+{
+  memcpy (state, SIGMA, sizeof (SIGMA));
+  memcpy (state + 4, key, 8 * sizeof (uint32_t));
+  state[12] = (uint32_t) counter;
+  state[13] = (uint32_t) (counter >> 32);
+  state[14] = (uint32_t) nonce;
+  state[15] = (uint32_t) (nonce >> 32);
+}
+
+inline uint32_t
+Rotl (uint32_t v, int c)
+{
+  return (v << c) | (v >> (32 - c));
+}
+
+#define RUI_QR(a, b, c, d)                            \
+  a += b; d ^= a; d = Rotl (d, 16);                   \
+  c += d; b ^= c; b = Rotl (b, 12);                   \
+  a += b; d ^= a; d = Rotl (d, 8);                    \
+  c += d; b ^= c; b = Rotl (b, 7);
+
+void
+BlocksScalar (const uint32_t key[8], uint64_t nonce, uint64_t counter,
+              uint32_t *out, std::size_t blocks, int rounds)
+{
+  uint32_t input[16];
+  for (std::size_t k = 0; k < blocks; k++)
+    {
+      InitState (input, key, nonce, counter + k);
+      uint32_t x[16];
+      memcpy (x, input, sizeof (x));
+      for (int r = 0; r < rounds; r += 2)
+        {
+          RUI_QR (x[0], x[4], x[8], x[12]);
+          RUI_QR (x[1], x[5], x[9], x[13]);
+          RUI_QR (x[2], x[6], x[10], x[14]);
+          RUI_QR (x[3], x[7], x[11], x[15]);
+          RUI_QR (x[0], x[5], x[10], x[15]);
+          RUI_QR (x[1], x[6], x[11], x[12]);
+          RUI_QR (x[2], x[7], x[8], x[13]);
+          RUI_QR (x[3], x[4], x[9], x[14]);
+        }
+      for (int w = 0; w < 16; w++)
+        {
+          out[16 * k + w] = x[w] + input[w];
+        }
+    }
+}
+
+#undef RUI_QR
+
+#ifdef RUI_CHACHA_X86
+// one block per lane: vector w holds word w of 8 (or 16) consecutive blocks,
+// transposed to block order when written out
+
+#define RUI_QR_V(a, b, c, d, ROT16, ROT12, ROT8, ROT7) \
+  a = ADD (a, b); d = XOR (d, a); d = ROT16 (d);      \
+  c = ADD (c, d); b = XOR (b, c); b = ROT12 (b);      \
+  a = ADD (a, b); d = XOR (d, a); d = ROT8 (d);       \
+  c = ADD (c, d); b = XOR (b, c); b = ROT7 (b);
+
+#define RUI_DOUBLE_ROUND_V(x, ROT16, ROT12, ROT8, ROT7)              \
+  RUI_QR_V (x[0], x[4], x[8], x[12], ROT16, ROT12, ROT8, ROT7)       \
+  RUI_QR_V (x[1], x[5], x[9], x[13], ROT16, ROT12, ROT8, ROT7)       \
+  RUI_QR_V (x[2], x[6], x[10], x[14], ROT16, ROT12, ROT8, ROT7)      \
+  RUI_QR_V (x[3], x[7], x[11], x[15], ROT16, ROT12, ROT8, ROT7)      \
+  RUI_QR_V (x[0], x[5], x[10], x[15], ROT16, ROT12, ROT8, ROT7)      \
+  RUI_QR_V (x[1], x[6], x[11], x[12], ROT16, ROT12, ROT8, ROT7)      \
+  RUI_QR_V (x[2], x[7], x[8], x[13], ROT16, ROT12, ROT8, ROT7)       \
+  RUI_QR_V (x[3], x[4], x[9], x[14], ROT16, ROT12, ROT8, ROT7)
+
+#define ADD _mm256_add_epi32
+#define XOR _mm256_xor_si256
+#define ROT16_256(v) _mm256_shuffle_epi8 (v, rot16)
+#define ROT8_256(v) _mm256_shuffle_epi8 (v, rot8)
+#define ROT12_256(v) _mm256_or_si256 (_mm256_slli_epi32 (v, 12), _mm256_srli_epi32 (v, 20))
+#define ROT7_256(v) _mm256_or_si256 (_mm256_slli_epi32 (v, 7), _mm256_srli_epi32 (v, 25))
+
+/// Write words 0-7 (or 8-15) of 8 blocks, x[w] holding word w of every block, in block order
+__attribute__ ((target ("avx2"))) inline void
+Transpose8x8Avx2 (const __m256i x[8], uint32_t *o)
+{
+  __m256i t0 = _mm256_unpacklo_epi32 (x[0], x[1]);
+  __m256i t1 = _mm256_unpackhi_epi32 (x[0], x[1]);
+  __m256i t2 = _mm256_unpacklo_epi32 (x[2], x[3]);
+  __m256i t3 = _mm256_unpackhi_epi32 (x[2], x[3]);
+  __m256i t4 = _mm256_unpacklo_epi32 (x[4], x[5]);
+  __m256i t5 = _mm256_unpackhi_epi32 (x[4], x[5]);
+  __m256i t6 = _mm256_unpacklo_epi32 (x[6], x[7]);
+  __m256i t7 = _mm256_unpackhi_epi32 (x[6], x[7]);
+  // words 0-3 of blocks b and b + 4 in u[b], words 4-7 in u[b + 4]
+  __m256i u[8];
+  u[0] = _mm256_unpacklo_epi64 (t0, t2);
+  u[1] = _mm256_unpackhi_epi64 (t0, t2);
+  u[2] = _mm256_unpacklo_epi64 (t1, t3);
+  u[3] = _mm256_unpackhi_epi64 (t1, t3);
+  u[4] = _mm256_unpacklo_epi64 (t4, t6);
+  u[5] = _mm256_unpackhi_epi64 (t4, t6);
+  u[6] = _mm256_unpacklo_epi64 (t5, t7);
+  u[7] = _mm256_unpackhi_epi64 (t5, t7);
+  for (int b = 0; b < 4; b++)
+    {
+      _mm256_storeu_si256 ((__m256i *) (o + 16 * b), _mm256_permute2x128_si256 (u[b], u[b + 4], 0x20));
+      _mm256_storeu_si256 ((__m256i *) (o + 16 * (b + 4)), _mm256_permute2x128_si256 (u[b], u[b + 4], 0x31));
+    }
+}
+
+__attribute__ ((target ("avx2"))) void
+BlocksAvx2 (const uint32_t key[8], uint64_t nonce, uint64_t counter,
+            uint32_t *out, std::size_t blocks, int rounds)
+{
+  const __m256i rot16 = _mm256_setr_epi8 (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                          2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+  const __m256i rot8 = _mm256_setr_epi8 (3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                         3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+  uint32_t state[16];
+  InitState (state, key, nonce, 0);
+  std::size_t k = 0;
+  for (; k + 8 <= blocks; k += 8)
+    {
+      __m256i input[16];
+      for (int w = 0; w < 16; w++)
+        {
+          input[w] = _mm256_set1_epi32 (state[w]);
+        }
+      // 64-bit counters of the 8 blocks, carries into word 13 included
+      alignas (32) uint32_t lo[8];
+      alignas (32) uint32_t hi[8];
+      for (int b = 0; b < 8; b++)
+        {
+          uint64_t c = counter + k + b;
+          lo[b] = (uint32_t) c;
+          hi[b] = (uint32_t) (c >> 32);
+        }
+      input[12] = _mm256_load_si256 ((const __m256i *) lo);
+      input[13] = _mm256_load_si256 ((const __m256i *) hi);
+
+      __m256i x[16];
+      for (int w = 0; w < 16; w++)
+        {
+          x[w] = input[w];
+        }
+      for (int r = 0; r < rounds; r += 2)
+        {
+          RUI_DOUBLE_ROUND_V (x, ROT16_256, ROT12_256, ROT8_256, ROT7_256)
+        }
+      for (int w = 0; w < 16; w++)
+        {
+          x[w] = _mm256_add_epi32 (x[w], input[w]);
+        }
+      uint32_t *o = out + 16 * k;
+      Transpose8x8Avx2 (x, o);
+      Transpose8x8Avx2 (x + 8, o + 8);
+    }
+  BlocksScalar (key, nonce, counter + k, out + 16 * k, blocks - k, rounds);
+}
+
+#undef ADD
+#undef XOR
+
+#define ADD _mm512_add_epi32
+#define XOR _mm512_xor_si512
+// the masked form of vprold with every lane set, the plain one makes GCC 12 warn about its undefined source
+#define ROT16_512(v) _mm512_mask_rol_epi32 (v, 0xffff, v, 16)
+#define ROT12_512(v) _mm512_mask_rol_epi32 (v, 0xffff, v, 12)
+#define ROT8_512(v) _mm512_mask_rol_epi32 (v, 0xffff, v, 8)
+#define ROT7_512(v) _mm512_mask_rol_epi32 (v, 0xffff, v, 7)
+
+__attribute__ ((target ("avx512f"))) void
+BlocksAvx512 (const uint32_t key[8], uint64_t nonce, uint64_t counter,
+              uint32_t *out, std::size_t blocks, int rounds)
+{
+  uint32_t state[16];
+  InitState (state, key, nonce, 0);
+  std::size_t k = 0;
+  for (; k + 16 <= blocks; k += 16)
+    {
+      __m512i input[16];
+      for (int w = 0; w < 16; w++)
+        {
+          input[w] = _mm512_set1_epi32 (state[w]);
+        }
+      alignas (64) uint32_t lo[16];
+      alignas (64) uint32_t hi[16];
+      for (int b = 0; b < 16; b++)
+        {
+          uint64_t c = counter + k + b;
+          lo[b] = (uint32_t) c;
+          hi[b] = (uint32_t) (c >> 32);
+        }
+      input[12] = _mm512_load_si512 (lo);
+      input[13] = _mm512_load_si512 (hi);
+
+      __m512i x[16];
+      for (int w = 0; w < 16; w++)
+        {
+          x[w] = input[w];
+        }
+      for (int r = 0; r < rounds; r += 2)
+        {
+          RUI_DOUBLE_ROUND_V (x, ROT16_512, ROT12_512, ROT8_512, ROT7_512)
+        }
+      // word w of block b goes to o[16 * b + w]: scatter each word vector with a stride of 16
+      const __m512i stride = _mm512_setr_epi32 (0, 16, 32, 48, 64, 80, 96, 112,
+                                                128, 144, 160, 176, 192, 208, 224, 240);
+      uint32_t *o = out + 16 * k;
+      for (int w = 0; w < 16; w++)
+        {
+          _mm512_i32scatter_epi32 (o + w, stride, _mm512_add_epi32 (x[w], input[w]), 4);
+        }
+    }
+  BlocksScalar (key, nonce, counter + k, out + 16 * k, blocks - k, rounds);
+}
+
+#undef ADD
+#undef XOR
+#undef RUI_QR_V
+#undef RUI_DOUBLE_ROUND_V
+#endif
+
+struct ChaChaKernel
+{
+  BlocksFunction blocks;
+  const char *name;
+};
+
+/// Set kernel to the implementation called name if the CPU has it, or to the best one for name 0
+bool
+SelectKernel (const char *name, ChaChaKernel &kernel)
+{
+#ifdef RUI_CHACHA_X86
+  __builtin_cpu_init ();
+  if ((name == 0 || strcmp (name, "avx512") == 0) && __builtin_cpu_supports ("avx512f"))
+    {
+      kernel = ChaChaKernel {&BlocksAvx512, "avx512"};
+      return true;
+    }
+  if ((name == 0 || strcmp (name, "avx2") == 0) && __builtin_cpu_supports ("avx2"))
+    {
+      kernel = ChaChaKernel {&BlocksAvx2, "avx2"};
+      return true;
+    }
+#endif
+  if (name == 0 || strcmp (name, "scalar") == 0)
+    {
+      kernel = ChaChaKernel {&BlocksScalar, "scalar"};
+      return true;
+    }
+  return false;
+}
+
+ChaChaKernel &
+GetKernel (void)
+{
+  static ChaChaKernel kernel = [] () {
+    ChaChaKernel best;
+    SelectKernel (0, best);
+    return best;
+  } ();
+  return kernel;
+}
+
+} // namespace
+
+void
+ChaChaStream (const uint32_t key[8], uint64_t nonce, uint64_t counter,
+              uint32_t *out, std::size_t words, int rounds)
+{
+  std::size_t blocks = words / 16;
+  GetKernel ().blocks (key, nonce, counter, out, blocks, rounds);
+  if (words % 16 != 0)
+    {
+      uint32_t last[16];
+      GetKernel ().blocks (key, nonce, counter + blocks, last, 1, rounds);
+      memcpy (out + 16 * blocks, last, (words % 16) * sizeof (uint32_t));
+    }
+}
+
+bool
+ChaChaUseKernel (const char *name)
+{
+  return SelectKernel (name, GetKernel ());
+}
+
+const char *
+ChaChaKernelName (void)
+{
+  return GetKernel ().name;
+}
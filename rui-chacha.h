@@ -0,0 +1,31 @@
+#ifndef RUI_CHACHA_H
+#define RUI_CHACHA_H
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Rui: ChaCha keystream (D. J. Bernstein) used to expand the pairwise mask
+ * seeds. Words 12-13 of the state hold a 64-bit block counter and words
+ * 14-15 a 64-bit nonce, as in the original ChaCha. The blocks are computed
+ * 16 (AVX-512), 8 (AVX2) or 1 at a time, picked once at run time, and every
+ * implementation writes the same stream, so vehicles with different CPUs
+ * agree on their masks.
+ */
+
+/// Default number of rounds, ChaCha12
+const int CHACHA_ROUNDS = 12;
+
+/**
+ * Write words 32-bit words of the stream of key and nonce, starting at the
+ * first word of block counter. rounds is even, 20 for ChaCha20.
+ */
+void ChaChaStream (const uint32_t key[8], uint64_t nonce, uint64_t counter,
+                   uint32_t *out, std::size_t words, int rounds = CHACHA_ROUNDS);
+
+/// Name of the selected implementation: "avx512", "avx2" or "scalar"
+const char *ChaChaKernelName (void);
+/// Use the implementation called name instead, e.g. to check it against "scalar";
+/// (0 for the best one again); false, keeping the current one, if the CPU does not have it
+bool ChaChaUseKernel (const char *name);
+
+#endif
@@ -0,0 +1,279 @@
+#include <cmath>
+#include <fstream>
+#include <map>
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "rui-cluster-config.h"
+#include "rui-crs-core.h"
+#include "rui-vehicle-beta.h"
+
+NS_LOG_COMPONENT_DEFINE ("rui-cluster-config");
+
+// the cluster of the paper, used until a program applies its own configuration
+int group_size = 20;
+std::vector<double> vehicle_beta = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1.0, 0.15, 0.25, 0.35, 0.45, 0.55, 0.65, 0.75, 0.85, 0.95, 0.98};
+std::vector<double> vehicle_obser = {51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70};
+std::vector<int> node_list = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
+std::vector<std::vector<int> > cluster_list = {node_list};
+int head_node = 10;
+int num_entries = 2000;
+double cluster_form_time = -1;
+double cluster_range = 100;
+int cluster_max_hops = 2;
+int cluster_max_count = 0;
+double error_rate = 0.01;
+uint64_t mask_key = 0;
+int mask_bits = 20;
+int fixed_beta_bits = 0;
+int fixed_point_width = 16;
+bool gf_coding = false;
+bool float_payload = false;
+
+//----------------------------------------------------------------------
+//-- ClusterConfig
+//------------------------------------------------------
+
+ClusterConfig::ClusterConfig ()
+  : m_size (group_size),
+    m_head (-1),
+    m_entries (num_entries),
+    m_count (1),
+    m_formTime (cluster_form_time),
+    m_range (cluster_range),
+    m_maxHops (cluster_max_hops),
+    m_maxCount (cluster_max_count),
+    m_errorRate (error_rate),
+    m_maskKey (mask_key),
+    m_maskBits (mask_bits),
+    m_fixedPoint (fixed_beta_bits),
+    m_fixedPointWidth (fixed_point_width),
+    m_gfCoding (gf_coding),
+    m_floatPayload (float_payload),
+    m_file (),
+    m_beta (),
+    m_obser (),
+    m_clusters ()
+{
+}
+
+void
+ClusterConfig::AddCommandLineValues (ns3::CommandLine &cmd)
+{
+  cmd.AddValue ("clusterSize", "number of vehicles in the cluster, head included", m_size);
+  cmd.AddValue ("clusterHead", "index of the cluster head, -1 for the middle of the cluster", m_head);
+  cmd.AddValue ("clusterEntries", "number of entries of an instance", m_entries);
+  cmd.AddValue ("clusterCount", "number of clusters of consecutive node IDs, when no nodes are given", m_count);
+  cmd.AddValue ("clusterConfig", "cluster file, see rui-cluster-config.h", m_file);
+  cmd.AddValue ("clusterFormTime", "form the clusters from the vehicle positions at that time (s), -1 to use the node IDs", m_formTime);
+  cmd.AddValue ("clusterRange", "radio range of one hop when forming clusters (m)", m_range);
+  cmd.AddValue ("clusterMaxHops", "largest hop count between a member and its head when forming clusters", m_maxHops);
+  cmd.AddValue ("clusterMaxCount", "largest number of clusters formed from positions, 0 for no limit", m_maxCount);
+  cmd.AddValue ("errorRate", "constant drop rate of the IP layer", m_errorRate);
+  cmd.AddValue ("maskKey", "key of the pairwise masks, 0 for the masks of the paper", m_maskKey);
+  cmd.AddValue ("maskBits", "bits of each pairwise mask word (1 to 24)", m_maskBits);
+  cmd.AddValue ("fixedPoint", "send the values quantized to integers, with the betas rounded to this many bits (1 to 16), 0 for floating point", m_fixedPoint);
+  cmd.AddValue ("fixedPointWidth", "bits of the quantized values with --fixedPoint, 8 or 16", m_fixedPointWidth);
+  cmd.AddValue ("gfCoding", "code the values as integers over GF(2^8) instead of with the real betas, decoded exactly at the head", m_gfCoding);
+  cmd.AddValue ("floatPayload", "send the floating-point values of the packets as float32 instead of float64", m_floatPayload);
+}
+
+bool
+ClusterConfig::Load (const std::string &filename)
+{
+  std::ifstream file (filename);
+  if (!file)
+    {
+      NS_LOG_ERROR ("Cannot open cluster file " << filename);
+      return false;
+    }
+  std::string line;
+  int line_number = 0;
+  while (std::getline (file, line))
+    {
+      line_number++;
+      std::vector<std::string_view> tokens;
+      for (std::string_view token : split (line, " "))
+        {
+          if (!token.empty ())
+            {
+              tokens.push_back (token);
+            }
+        }
+      if (tokens.empty () || tokens[0][0] == '#')
+        {
+          continue;
+        }
+
+      bool ok = tokens.size () >= 2;
+      int number = 0;
+      if (tokens[0] == "size" || tokens[0] == "head" || tokens[0] == "entries")
+        {
+          ok = ok && tokens.size () == 2 && ParseNumber (tokens[1], number);
+          if (tokens[0] == "size")
+            {
+              m_size = number;
+            }
+          else if (tokens[0] == "head")
+            {
+              m_head = number;
+            }
+          else
+            {
+              m_entries = number;
+            }
+        }
+      else if (tokens[0] == "beta" || tokens[0] == "obser")
+        {
+          std::vector<double> &values = tokens[0] == "beta" ? m_beta : m_obser;
+          values.resize (tokens.size () - 1);
+          for (uint32_t k = 1; k < tokens.size () && ok; k++)
+            {
+              ok = ParseNumber (tokens[k], values[k - 1]);
+            }
+        }
+      else if (tokens[0] == "nodes")
+        {
+          m_clusters.push_back (std::vector<int> (tokens.size () - 1));
+          for (uint32_t k = 1; k < tokens.size () && ok; k++)
+            {
+              ok = ParseNumber (tokens[k], m_clusters.back ()[k - 1]);
+            }
+        }
+      else
+        {
+          ok = false;
+        }
+      if (!ok)
+        {
+          NS_LOG_ERROR (filename << ":" << line_number << ": cannot read \"" << line << "\"");
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+ClusterConfig::Apply (void)
+{
+  if (!m_file.empty () && !Load (m_file))
+    {
+      NS_FATAL_ERROR ("Invalid cluster file " << m_file);
+    }
+  if (m_size < 2)
+    {
+      NS_FATAL_ERROR ("A cluster needs a head and at least one member, got " << m_size);
+    }
+  if (m_size > CodedPacket::MAX_GROUP_SIZE)
+    {
+      NS_FATAL_ERROR ("Clusters of " << m_size << " vehicles, at most " << CodedPacket::MAX_GROUP_SIZE << " in the contributor bitmap");
+    }
+  int head = m_head < 0 ? m_size / 2 : m_head;
+  if (head >= (int) m_size)
+    {
+      NS_FATAL_ERROR ("Cluster head " << head << " outside a cluster of " << m_size);
+    }
+  if ((!m_beta.empty () && m_beta.size () != m_size)
+      || (!m_obser.empty () && m_obser.size () != m_size))
+    {
+      NS_FATAL_ERROR ("The beta and obser lists need " << m_size << " values each");
+    }
+
+  // the scalar programs keep a masked observation in an int
+  if (m_maskKey != 0
+      && (m_maskBits < 1 || m_maskBits > 24 || (double) (m_size - 1) * (1 << m_maskBits) >= 2147483647.0))
+    {
+      NS_FATAL_ERROR ("Pairwise masks of " << m_maskBits << " bits do not fit an int in a cluster of " << m_size);
+    }
+
+  std::vector<std::vector<int> > clusters = m_clusters;
+  if (clusters.empty ())
+    {
+      for (uint32_t k = 0; k < std::max<uint32_t> (m_count, 1); k++)
+        {
+          std::vector<int> nodes (m_size);
+          for (uint32_t i = 0; i < m_size; i++)
+            {
+              nodes[i] = k * m_size + i;
+            }
+          clusters.push_back (nodes);
+        }
+    }
+  std::map<int, uint32_t> seen;
+  for (uint32_t k = 0; k < clusters.size (); k++)
+    {
+      if (clusters[k].size () != m_size)
+        {
+          NS_FATAL_ERROR ("Cluster " << k << " has " << clusters[k].size () << " nodes, expected " << m_size);
+        }
+      for (int node : clusters[k])
+        {
+          if (!seen.insert (std::make_pair (node, k)).second)
+            {
+              NS_FATAL_ERROR ("Node " << node << " is in cluster " << seen[node] << " and cluster " << k);
+            }
+        }
+    }
+
+  std::vector<double> beta (vehicle_beta.begin (), vehicle_beta.begin () + std::min<size_t> (m_size, vehicle_beta.size ()));
+  std::vector<double> obser (vehicle_obser.begin (), vehicle_obser.begin () + std::min<size_t> (m_size, vehicle_obser.size ()));
+  for (uint32_t i = beta.size (); i < m_size; i++)
+    {
+      // spread over (0.1, 1.0) by the golden ratio, so no two vehicles share a beta
+      double fraction = i * 0.6180339887498949;
+      beta.push_back (0.1 + 0.9 * (fraction - std::floor (fraction)));
+    }
+  for (uint32_t i = obser.size (); i < m_size; i++)
+    {
+      obser.push_back (51 + i);
+    }
+
+  group_size = m_size;
+  head_node = head;
+  num_entries = m_entries;
+  vehicle_beta = m_beta.empty () ? beta : m_beta;
+  vehicle_obser = m_obser.empty () ? obser : m_obser;
+  cluster_list = clusters;
+  node_list = cluster_list[0];
+  cluster_form_time = m_formTime;
+  cluster_range = m_range;
+  cluster_max_hops = m_maxHops;
+  cluster_max_count = m_maxCount;
+  error_rate = m_errorRate;
+  mask_key = m_maskKey;
+  mask_bits = m_maskBits;
+  fixed_beta_bits = m_fixedPoint;
+  fixed_point_width = m_fixedPointWidth;
+  if (fixed_beta_bits > 0)
+    {
+      if (fixed_beta_bits > 16)
+        {
+          NS_FATAL_ERROR ("Fixed-point betas of " << fixed_beta_bits << " bits, at most 16");
+        }
+      if (fixed_point_width != 8 && fixed_point_width != 16)
+        {
+          NS_FATAL_ERROR ("Quantized values of " << fixed_point_width << " bits, 8 or 16");
+        }
+      vehicle_beta = FixedPointBeta (vehicle_beta, fixed_beta_bits);
+      for (uint32_t i = 0; i < vehicle_beta.size (); i++)
+        {
+          if (vehicle_beta[i] == 0)
+            {
+              NS_FATAL_ERROR ("The beta of vehicle " << i << " rounds to 0 with --fixedPoint=" << fixed_beta_bits << ", use more bits");
+            }
+        }
+    }
+  gf_coding = m_gfCoding;
+  if (gf_coding)
+    {
+      if (fixed_beta_bits > 0)
+        {
+          NS_FATAL_ERROR ("--gfCoding and --fixedPoint are two different codings, pick one");
+        }
+      if (group_size > 255)
+        {
+          NS_FATAL_ERROR ("Clusters of " << group_size << " vehicles, at most 255 with --gfCoding");
+        }
+    }
+  float_payload = m_floatPayload;
+  NS_LOG_INFO (cluster_list.size () << " cluster(s) of " << group_size << " vehicles, head " << head_node << ", " << num_entries << " entries");
+}
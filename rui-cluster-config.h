@@ -0,0 +1,74 @@
+#ifndef RUI_CLUSTER_CONFIG_H
+#define RUI_CLUSTER_CONFIG_H
+#include <string>
+#include <vector>
+#include "ns3/command-line.h"
+
+/**
+ * \brief Size and contents of the cluster shared by every program.
+ *
+ * Fills group_size, vehicle_beta, vehicle_obser, node_list, cluster_list,
+ * head_node and num_entries (see rui-vehicle-beta.h). Without a file, a
+ * cluster of any size is generated: the first 20 vehicles keep the values
+ * of the paper, the others get their own beta and observation. A file overrides any of
+ * them, one "key value value ..." line per setting:
+ *
+ *   size 50
+ *   head 10
+ *   entries 2000
+ *   beta 0.1 0.2 ...      (size values)
+ *   obser 51 52 ...       (size values)
+ *   nodes 0 1 2 ...       (size node IDs, e.g. SUMO vehicles)
+ *   nodes 40 41 42 ...    (each further nodes line adds a cluster)
+ *
+ * All clusters have size vehicles and their head at index head, so the
+ * betas and masks of an index are the same in every cluster. Without nodes
+ * lines, --clusterCount clusters of consecutive node IDs are formed.
+ *
+ * With --clusterFormTime, a program that supports it replaces cluster_list
+ * at that time by clusters formed from the vehicle positions (see
+ * FormSpatialClusters in rui-spatial-cluster.h).
+ *
+ * Usage, before any helper that sizes itself from group_size is created:
+ *
+ *   ClusterConfig cluster;
+ *   CommandLine cmd;
+ *   cluster.AddCommandLineValues (cmd);
+ *   cmd.Parse (argc, argv);
+ *   cluster.Apply ();
+ */
+class ClusterConfig
+{
+public:
+  ClusterConfig ();
+
+  /// --clusterSize, --clusterHead, --clusterEntries, --clusterCount, --clusterConfig and the --cluster{FormTime,Range,MaxHops,MaxCount}, --errorRate, --mask{Key,Bits}, --fixedPoint{,Width}, --gfCoding and --floatPayload
+  void AddCommandLineValues (ns3::CommandLine &cmd);
+  /// Read the settings of a cluster file, false if it cannot be read or is malformed
+  bool Load (const std::string &filename);
+  /// Size and fill the shared cluster settings
+  void Apply (void);
+
+private:
+  uint32_t m_size;
+  int32_t m_head;       //!< -1: middle of the cluster
+  uint32_t m_entries;
+  uint32_t m_count;
+  double m_formTime;    //!< <0: clusters from the node IDs
+  double m_range;
+  uint32_t m_maxHops;
+  uint32_t m_maxCount;
+  double m_errorRate;
+  uint64_t m_maskKey;   //!< 0: masks of the paper
+  uint32_t m_maskBits;
+  uint32_t m_fixedPoint; //!< 0: floating point values
+  uint32_t m_fixedPointWidth; //!< bits of the quantized values
+  bool m_gfCoding;
+  bool m_floatPayload;
+  std::string m_file;
+  std::vector<double> m_beta;
+  std::vector<double> m_obser;
+  std::vector<std::vector<int> > m_clusters;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "rui-coded-packet.h"
+
+using namespace ns3;
+
+//----------------------------------------------------------------------
+//-- CodedPacketHeader
+//------------------------------------------------------
+
+CodedPacketHeader::CodedPacketHeader ()
+{
+}
+
+TypeId
+CodedPacketHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("CodedPacketHeader")
+    .SetParent<Header> ()
+    .AddConstructor<CodedPacketHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+CodedPacketHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+CodedPacketHeader::GetSerializedSize (void) const
+{
+  return CodedPacket::GetSerializedSize ();
+}
+
+void
+CodedPacketHeader::Serialize (Buffer::Iterator start) const
+{
+  Write (start);
+}
+
+uint32_t
+CodedPacketHeader::Deserialize (Buffer::Iterator start)
+{
+  return Read (start);
+}
+
+void
+CodedPacketHeader::Print (std::ostream &os) const
+{
+  CodedPacket::Print (os);
+}
@@ -0,0 +1,28 @@
+#ifndef RUI_CODED_PACKET_H
+#define RUI_CODED_PACKET_H
+#include <iostream>
+#include <vector>
+#include "ns3/header.h"
+#include "rui-crs-packet.h"
+
+/**
+ * \brief Binary header carried in the UDP payload of all CRS packets.
+ *
+ * Replaces the "node+node|value" text payloads. The content and the wire
+ * layout are those of CodedPacket (rui-crs-packet.h), this class only
+ * makes it an ns-3 header.
+ */
+class CodedPacketHeader : public ns3::Header, public CodedPacket
+{
+public:
+  CodedPacketHeader ();
+
+  static ns3::TypeId GetTypeId (void);
+  virtual ns3::TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (ns3::Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (ns3::Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include <cmath>
+#include <cstring>
+#include "rui-coding-kernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RUI_CODING_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*AxpbyFunction) (double *y, const double *x, double a, double b, std::size_t n);
+typedef void (*TruncAddFunction) (double *y, double b, std::size_t n);
+
+void
+AxpbyScalar (double *y, const double *x, double a, double b, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] = b * y[i] + a * x[i];
+    }
+}
+
+void
+TruncAddScalar (double *y, double b, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] = std::trunc (y[i]) + b;
+    }
+}
+
+#ifdef RUI_CODING_X86
+__attribute__ ((target ("avx2"))) void
+TruncAddAvx2 (double *y, double b, std::size_t n)
+{
+  const __m256d vb = _mm256_set1_pd (b);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256d y0 = _mm256_round_pd (_mm256_loadu_pd (y + i), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      _mm256_storeu_pd (y + i, _mm256_add_pd (y0, vb));
+    }
+  TruncAddScalar (y + i, b, n - i);
+}
+
+__attribute__ ((target ("avx512f"))) void
+TruncAddAvx512 (double *y, double b, std::size_t n)
+{
+  const __m512d vb = _mm512_set1_pd (b);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      __m512d y0 = _mm512_loadu_pd (y + i);
+      y0 = _mm512_mask_roundscale_pd (y0, 0xff, y0, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      _mm512_storeu_pd (y + i, _mm512_add_pd (y0, vb));
+    }
+  TruncAddScalar (y + i, b, n - i);
+}
+
+__attribute__ ((target ("avx2,fma"))) void
+AxpbyAvx2 (double *y, const double *x, double a, double b, std::size_t n)
+{
+  const __m256d va = _mm256_set1_pd (a);
+  const __m256d vb = _mm256_set1_pd (b);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      __m256d y0 = _mm256_loadu_pd (y + i);
+      __m256d y1 = _mm256_loadu_pd (y + i + 4);
+      y0 = _mm256_fmadd_pd (va, _mm256_loadu_pd (x + i), _mm256_mul_pd (vb, y0));
+      y1 = _mm256_fmadd_pd (va, _mm256_loadu_pd (x + i + 4), _mm256_mul_pd (vb, y1));
+      _mm256_storeu_pd (y + i, y0);
+      _mm256_storeu_pd (y + i + 4, y1);
+    }
+  for (; i < n; i++)
+    {
+      y[i] = b * y[i] + a * x[i];
+    }
+}
+
+__attribute__ ((target ("avx512f"))) void
+AxpbyAvx512 (double *y, const double *x, double a, double b, std::size_t n)
+{
+  const __m512d va = _mm512_set1_pd (a);
+  const __m512d vb = _mm512_set1_pd (b);
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+    {
+      __m512d y0 = _mm512_loadu_pd (y + i);
+      __m512d y1 = _mm512_loadu_pd (y + i + 8);
+      y0 = _mm512_fmadd_pd (va, _mm512_loadu_pd (x + i), _mm512_mul_pd (vb, y0));
+      y1 = _mm512_fmadd_pd (va, _mm512_loadu_pd (x + i + 8), _mm512_mul_pd (vb, y1));
+      _mm512_storeu_pd (y + i, y0);
+      _mm512_storeu_pd (y + i + 8, y1);
+    }
+  if (i < n)
+    {
+      // masked tail, n - i < 16 entries left
+      __mmask8 m0 = (__mmask8) ((n - i >= 8) ? 0xff : ((1u << (n - i)) - 1));
+      __m512d y0 = _mm512_maskz_loadu_pd (m0, y + i);
+      y0 = _mm512_fmadd_pd (va, _mm512_maskz_loadu_pd (m0, x + i), _mm512_mul_pd (vb, y0));
+      _mm512_mask_storeu_pd (y + i, m0, y0);
+      i += 8;
+      if (i < n)
+        {
+          __mmask8 m1 = (__mmask8) ((1u << (n - i)) - 1);
+          __m512d y1 = _mm512_maskz_loadu_pd (m1, y + i);
+          y1 = _mm512_fmadd_pd (va, _mm512_maskz_loadu_pd (m1, x + i), _mm512_mul_pd (vb, y1));
+          _mm512_mask_storeu_pd (y + i, m1, y1);
+        }
+    }
+}
+#endif
+
+struct CodingKernel
+{
+  AxpbyFunction axpby;
+  TruncAddFunction truncadd;
+  const char *name;
+};
+
+/// Set kernel to the implementation called name if the CPU has it, or to the best one for name 0
+bool
+SelectKernel (const char *name, CodingKernel &kernel)
+{
+#ifdef RUI_CODING_X86
+  __builtin_cpu_init ();
+  if ((name == 0 || strcmp (name, "avx512") == 0) && __builtin_cpu_supports ("avx512f"))
+    {
+      kernel = CodingKernel {&AxpbyAvx512, &TruncAddAvx512, "avx512"};
+      return true;
+    }
+  if ((name == 0 || strcmp (name, "avx2") == 0) && __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+    {
+      kernel = CodingKernel {&AxpbyAvx2, &TruncAddAvx2, "avx2"};
+      return true;
+    }
+#endif
+  if (name == 0 || strcmp (name, "scalar") == 0)
+    {
+      kernel = CodingKernel {&AxpbyScalar, &TruncAddScalar, "scalar"};
+      return true;
+    }
+  return false;
+}
+
+CodingKernel &
+GetKernel (void)
+{
+  static CodingKernel kernel = [] () {
+    CodingKernel best;
+    SelectKernel (0, best);
+    return best;
+  } ();
+  return kernel;
+}
+
+} // namespace
+
+void
+CodingAxpy (double *y, const double *x, double a, std::size_t n)
+{
+  GetKernel ().axpby (y, x, a, 1.0, n);
+}
+
+void
+CodingAxpby (double *y, const double *x, double a, double b, std::size_t n)
+{
+  GetKernel ().axpby (y, x, a, b, n);
+}
+
+void
+CodingTruncAdd (double *y, double b, std::size_t n)
+{
+  GetKernel ().truncadd (y, b, n);
+}
+
+bool
+CodingUseKernel (const char *name)
+{
+  return SelectKernel (name, GetKernel ());
+}
+
+const char *
+CodingKernelName (void)
+{
+  return GetKernel ().name;
+}
@@ -0,0 +1,26 @@
+#ifndef RUI_CODING_KERNEL_H
+#define RUI_CODING_KERNEL_H
+#include <cstddef>
+
+/*
+ * Rui: vector kernels for network coding over the entries of a packet.
+ * The implementation (AVX-512, AVX2+FMA or scalar) is picked once at run
+ * time from the CPU the simulation runs on.
+ */
+
+/// y[i] = y[i] + a * x[i], e.g. a router adding beta_i * masked_obs_i to a coded sum
+void CodingAxpy (double *y, const double *x, double a, std::size_t n);
+
+/// y[i] = b * y[i] + a * x[i], e.g. the first router scaling the original values by beta_source
+void CodingAxpby (double *y, const double *x, double a, double b, std::size_t n);
+
+/// y[i] = trunc (y[i]) + b, e.g. the masks of the paper added to the integer part of the observations
+void CodingTruncAdd (double *y, double b, std::size_t n);
+
+/// Name of the selected implementation: "avx512", "avx2" or "scalar"
+const char *CodingKernelName (void);
+/// Use the implementation called name instead, e.g. to check it against "scalar";
+/// (0 for the best one again); false, keeping the current one, if the CPU does not have it
+bool CodingUseKernel (const char *name);
+
+#endif
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cmath>
+#include "rui-crs-context.h"
+#include "rui-vehicle-beta.h"
+
+using namespace ns3;
+
+namespace {
+
+//Rui: aggregated to each node of a simulation to point at its context. The context
+//itself cannot be aggregated to several nodes, as aggregation merges the objects.
+class CrsContextLink : public Object
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("CrsContextLink")
+      .SetParent<Object> ()
+    ;
+    return tid;
+  }
+
+  Ptr<CrsContext> m_context;
+};
+
+} // namespace
+
+//----------------------------------------------------------------------
+//-- CrsContext
+//------------------------------------------------------
+
+NS_OBJECT_ENSURE_REGISTERED (CrsContext);
+
+TypeId
+CrsContext::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("CrsContext")
+    .SetParent<Object> ()
+    .AddConstructor<CrsContext> ()
+  ;
+  return tid;
+}
+
+CrsContext::CrsContext ()
+  : fixed_value_bytes (0)
+{
+}
+
+void
+CrsContext::Install (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Ptr<CrsContextLink> link = (*i)->GetObject<CrsContextLink> ();
+      if (link == 0)
+        {
+          link = CreateObject<CrsContextLink> ();
+          (*i)->AggregateObject (link);
+        }
+      link->m_context = this;
+    }
+}
+
+Ptr<CrsContext>
+CrsContext::Get (Ptr<Node> node)
+{
+  Ptr<CrsContextLink> link = node->GetObject<CrsContextLink> ();
+  if (link == 0)
+    {
+      return 0;
+    }
+  return link->m_context;
+}
+
+double
+CrsContext::MaxMasked (void) const
+{
+  double max_value = 0;
+  for (double v : mask_obser)
+    {
+      max_value = std::max (max_value, std::fabs (v));
+    }
+  for (const std::vector<double> &entries : mask_obser_instance)
+    {
+      for (double v : entries)
+        {
+          max_value = std::max (max_value, std::fabs (v));
+        }
+    }
+  return max_value;
+}
+
+bool
+CrsContext::QuantizeMasks (int bits)
+{
+  size_t size = std::max (mask_obser.size (), mask_obser_instance.size ());
+  quantized_obser.assign (size, Quantized ());
+  for (size_t i = 0; i < size; i++)
+    {
+      std::vector<double> masked = i < mask_obser_instance.size () ? mask_obser_instance[i]
+                                                                     : std::vector<double> (1, mask_obser[i]);
+      if (!Quantize (masked, bits, quantized_obser[i]))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+bool
+CrsContext::SizeField (void)
+{
+  fixed_value_bytes = FixedPointBytes (MaxMasked (), 1, 1);
+  return fixed_value_bytes > 0;
+}
+
+//----------------------------------------------------------------------
+//-- IpDropModel
+//------------------------------------------------------
+
+NS_OBJECT_ENSURE_REGISTERED (IpDropModel);
+
+TypeId
+IpDropModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("IpDropModel")
+    .SetParent<Object> ()
+    .AddConstructor<IpDropModel> ()
+  ;
+  return tid;
+}
+
+IpDropModel::IpDropModel ()
+  : m_rng (CreateObject<UniformRandomVariable> ())
+{
+}
+
+bool
+IpDropModel::Drop (void)
+{
+  return error_rate > 0 && m_rng->GetValue (0.0, 1.0) < error_rate;
+}
+
+int64_t
+IpDropModel::AssignStreams (int64_t stream)
+{
+  m_rng->SetStream (stream);
+  return 1;
+}
+
+int64_t
+IpDropModel::AssignStreams (NodeContainer nodes, int64_t stream)
+{
+  int64_t current = stream;
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Ptr<IpDropModel> drop = (*i)->GetObject<IpDropModel> ();
+      if (drop != 0)
+        {
+          current += drop->AssignStreams (current);
+        }
+    }
+  return current - stream;
+}
@@ -0,0 +1,88 @@
+#ifndef RUI_CRS_CONTEXT_H
+#define RUI_CRS_CONTEXT_H
+#include <map>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/random-variable-stream.h"
+#include "rui-crs-core.h"
+
+/**
+ * \brief The CRS state of one simulation.
+ *
+ * Holds what the program and the routers share during a simulation: the
+ * maps from addresses and node IDs to vehicles, the masked observations and
+ * the statistics of the routers. The program creates it and installs it on
+ * its nodes; the AODV forwarding hook finds it from the node of the router
+ * (CrsContext::Get), and does no CRS coding on nodes without one. Several
+ * simulations (clusters, rounds, replications) can run in one process, each
+ * with its own context.
+ *
+ * The fields are filled by the program as it sets up the cluster, except the
+ * statistics, which are updated by the routers.
+ */
+class CrsContext : public ns3::Object
+{
+public:
+  static ns3::TypeId GetTypeId (void);
+  CrsContext ();
+
+  /// Make the context reachable from the routers of nodes
+  void Install (ns3::NodeContainer nodes);
+  /// The context installed on node, 0 if none
+  static ns3::Ptr<CrsContext> Get (ns3::Ptr<ns3::Node> node);
+  /// Quantize the masked values of each vehicle, mask_obser_instance or else mask_obser, to
+  /// integers of bits bits into quantized_obser (--fixedPoint); false if one cannot be quantized
+  bool QuantizeMasks (int bits);
+  /// Size fixed_value_bytes for the masked observations alone (--gfCoding), as the field
+  /// coding never adds them up; false if they are not exact integers in double
+  bool SizeField (void);
+
+  DenseIdMap address_to_id; //IP addresses (Ipv4Address::Get) to vehicle IDs
+  DenseIdMap node_ID_to_index; //node ID to its index in its cluster
+  DenseIdMap node_ID_to_cluster; //cluster of each node, for programs that run several clusters
+
+  std::vector<double> mask_obser; //masked observation of each vehicle
+  std::vector<std::vector<double> > mask_obser_instance; //masked entries of each vehicle
+  std::vector<AlignedVector> relay_contribution_instance; //beta * mask_obser_instance of each vehicle, built with the masks
+  std::vector<std::vector<uint8_t> > relay_field_contribution_instance; //mask_obser_instance as GF(2^8) symbols (--gfCoding), built once fixed_value_bytes is set
+  int fixed_value_bytes; //bytes of each value of the field packets, set with the masks
+  std::vector<Quantized> quantized_obser; //masked values of each vehicle quantized (--fixedPoint), what a router adds to FIXED packets
+
+  std::map<int, int> stat_network_coding_time; //the time used for network_coding part for each router (node ID), as the programs print it next to stat_relay_frames
+  std::map<int, int> stat_relay_frames; //the number of frames each router (node ID) put on the air when forwarding
+
+private:
+  /// largest |value| of mask_obser and mask_obser_instance
+  double MaxMasked (void) const;
+};
+
+/**
+ * \brief The constant drop of the IP layer (--errorRate) of one node.
+ *
+ * Ipv4L3Protocol aggregates one to its node when it is given the node, and
+ * draws from it for every packet it receives, so each node has its own
+ * random stream rather than one shared by all stacks of the process. The
+ * streams are assigned by ns-3 in creation order and follow --RngSeed and
+ * --RngRun; AssignStreams fixes them, as for the mobility models.
+ */
+class IpDropModel : public ns3::Object
+{
+public:
+  static ns3::TypeId GetTypeId (void);
+  IpDropModel ();
+
+  /// true if the next received packet is dropped, with probability error_rate
+  bool Drop (void);
+  /// Use stream for the drops of this node; returns the number of streams used (1)
+  int64_t AssignStreams (int64_t stream);
+  /// Assign consecutive streams to the drop models of nodes, from stream;
+  /// returns the number of streams used
+  static int64_t AssignStreams (ns3::NodeContainer nodes, int64_t stream);
+
+private:
+  ns3::Ptr<ns3::UniformRandomVariable> m_rng;
+};
+
+#endif
@@ -0,0 +1,1374 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <charconv>
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include "rui-crs-core.h"
+#include "rui-coding-kernel.h"
+#include "rui-chacha.h"
+#include "rui-gf256.h"
+using namespace std;
+
+DataRecoveryHelper::DataRecoveryHelper(void)
+  :N(),
+  M(),
+  K(),
+  rank(),
+  s(),
+  solved(),
+  m(),
+  pivot_col()
+{
+}
+
+void DataRecoveryHelper::SetParameters(int num_v, int num_f, vector<vector<double> > coe)
+{
+    Reset(num_v, num_f, 1);
+    for (int i = 0; i < M; i++)
+        copy(coe[i].begin(), coe[i].begin()+N+1, m.begin()+(size_t)i*(N+K));
+}
+
+void DataRecoveryHelper::SetParametersBatch(int num_v, int num_f, const vector<vector<double> > &coe, const vector<double> &rhs, int num_rhs)
+{
+    Reset(num_v, num_f, num_rhs);
+    for (int i = 0; i < M; i++)
+    {
+        copy(coe[i].begin(), coe[i].begin()+N, m.begin()+(size_t)i*(N+K));
+        copy(rhs.begin()+(size_t)i*K, rhs.begin()+(size_t)(i+1)*K, m.begin()+(size_t)i*(N+K)+N);
+    }
+}
+
+void DataRecoveryHelper::Reset(int num_v, int num_f, int num_rhs)
+{
+    N = num_v;
+    M = num_f;
+    K = num_rhs;
+    rank = 0;
+    s = vector<vector<double> >(K, vector<double>(N));
+    solved = vector<bool>(N, false);
+    pivot_col = vector<int>(M, -1);
+    m.resize((size_t)M*(N+K));
+}
+
+vector<double> DataRecoveryHelper::GetResults()
+{
+    return s.empty() ? vector<double>() : s[0];
+}
+
+vector<vector<double> > DataRecoveryHelper::GetResultsBatch()
+{
+    return s;
+}
+
+vector<bool> DataRecoveryHelper::GetSolved()
+{
+    return solved;
+}
+
+int DataRecoveryHelper::GetRank()
+{
+    return rank;
+}
+
+void DataRecoveryHelper::SwapRows(int a, int b)
+{
+	if (a == b)
+		return;
+	swap_ranges(m.begin()+(size_t)a*(N+K), m.begin()+(size_t)(a+1)*(N+K), m.begin()+(size_t)b*(N+K));
+}
+
+void DataRecoveryHelper::Eliminate(int row, int col)
+{
+	//the right-hand sides sit after the N coefficients of each row, so one
+	//row update carries every entry along with the coefficients
+	double *pivot_row = &m[(size_t)row*(N+K)];
+	double t = 1.0/pivot_row[col];
+	for (int k = col; k < N + K; k++)
+		pivot_row[k] *= t;
+	pivot_row[col] = 1.0;
+	for (int i = 0; i < M; i++)
+	{
+		double *r = &m[(size_t)i*(N+K)];
+		if (i == row || r[col] == 0)
+			continue;
+		CodingAxpy(r+col, pivot_row+col, -r[col], N+K-col);
+		r[col] = 0;
+	}
+}
+
+//entries below this are treated as 0, relative to the largest coefficient
+double DataRecoveryHelper::Tolerance()
+{
+	double largest = 1.0;
+	for (int i = 0; i < M; i++)
+		for (int k = 0; k < N; k++)
+			largest = max(largest, abs(m[(size_t)i*(N+K)+k]));
+	return 1e-9*largest;
+}
+
+void DataRecoveryHelper::pc()
+{
+	//Gauss-Jordan elimination with partial pivoting, the pivots only depend
+	//on the coefficients so all K right-hand sides are solved in one pass
+	double tol = Tolerance();
+	int row = 0;
+	for (int col = 0; col < N && row < M; col++)
+	{
+		int best = row;
+		for (int i = row + 1; i < M; i++)
+			if (abs(m[(size_t)i*(N+K)+col]) > abs(m[(size_t)best*(N+K)+col]))
+				best = i;
+		if (abs(m[(size_t)best*(N+K)+col]) <= tol)
+			continue;//no pivot in this column, the variable is free
+		SwapRows(best, row);
+		Eliminate(row, col);
+		pivot_col[row] = col;
+		row++;
+	}
+	rank = row;
+
+	//a variable is known if its pivot row has no free variable left
+	vector<bool> is_pivot(N, false);
+	for (int i = 0; i < rank; i++)
+		is_pivot[pivot_col[i]] = true;
+	for (int i = 0; i < rank; i++)
+	{
+		const double *r = &m[(size_t)i*(N+K)];
+		bool tag = true;
+		for (int k = 0; k < N && tag; k++)
+			if (!is_pivot[k] && abs(r[k]) > tol)
+				tag = false; //no answer
+		if (tag)
+		{
+			for (int e = 0; e < K; e++)
+				s[e][pivot_col[i]] = r[N+e];
+			solved[pivot_col[i]] = true;
+		}
+	}
+	for (int i = rank; i < M; i++)
+		for (int e = 0; e < K; e++)
+			if (abs(m[(size_t)i*(N+K)+N+e]) > tol)
+			{
+				CRS_LOG_DEBUG("Inconsistent function " << i << ", right-hand side " << e << ", residual " << m[(size_t)i*(N+K)+N+e]);
+				break;
+			}
+}
+
+
+int MaskObservation(int raw_obser, int index, int size)
+{
+  double mask = 0;
+  for (int j=index+1; j<size; j++)
+  {
+    mask = ( j + index ) % 10; 
+    raw_obser = raw_obser + mask;
+  }
+  for (int j=0; j<index; j++)
+  {
+    mask = ( j + index ) % 10; 
+    raw_obser = raw_obser - mask;
+  }
+  return raw_obser; //masked value
+}
+
+vector<double> FixedPointBeta(const vector<double> &beta, int bits)
+{
+  vector<double> fixed(beta.size());
+  for (size_t i = 0; i < beta.size(); i++)
+    fixed[i] = std::round(std::ldexp(beta[i], bits));
+  return fixed;
+}
+
+int FixedPointBytes(double max_value, double max_beta, int size)
+{
+  //a coded sum has at most size terms beta * value
+  double bound = (double) size * max_beta * max_value;
+  if (bound >= std::ldexp(1.0, 53))
+    return 0;
+  int bytes = 1;
+  while (bound >= std::ldexp(1.0, 8*bytes-1))
+    bytes++;
+  return bytes;
+}
+
+bool Quantize(const vector<double> &values, int bits, Quantized &quantized)
+{
+  assert(bits >= 2 && bits <= 32);
+  double largest = 0;
+  for (double v : values)
+  {
+    if (!std::isfinite(v))
+      return false;
+    largest = max(largest, std::fabs(v));
+  }
+  //largest / limit = m * 2^scale with m in [0.5, 1), so largest / 2^scale < limit and rounds to at
+  //most limit; one step finer may still round to limit. Zeros keep the scale 0, so they do
+  //not pull the scale of the coded sums down
+  double limit = std::ldexp(1.0, bits-1) - 1;
+  int scale = 0;
+  if (largest > 0)
+  {
+    std::frexp(largest / limit, &scale);
+    if (std::round(std::ldexp(largest, 1-scale)) <= limit)
+      scale--;
+    scale = max(scale, INT8_MIN);
+  }
+  if (scale > INT8_MAX)
+  {
+    CRS_LOG_DEBUG("Value " << largest << " too large to quantize to " << bits << " bits");
+    return false;
+  }
+  quantized.scale = scale;
+  quantized.integers.resize(values.size());
+  for (size_t k = 0; k < values.size(); k++)
+    quantized.integers[k] = std::llround(std::ldexp(values[k], -scale));
+  return true;
+}
+
+//sum of t % 10 for t = 0 .. n-1
+static int SumMod10(int n)
+{
+  int r = n % 10;
+  return 45*(n/10) + r*(r-1)/2;
+}
+
+vector<int> MaskOffsets(int size)
+{
+  //MaskObservation adds (j + i) % 10 for j > i and subtracts it for j < i
+  vector<int> offsets(size);
+  for (int i = 0; i < size; i++)
+  {
+    int plus = SumMod10(size+i) - SumMod10(2*i+1);
+    int minus = SumMod10(2*i) - SumMod10(i);
+    offsets[i] = plus - minus;
+  }
+  return offsets;
+}
+
+void MaskObservations(double *values, size_t n, int offset)
+{
+  CodingTruncAdd(values, offset, n);
+}
+
+PairwiseMasker::PairwiseMasker(uint64_t key, int size, int bits)
+  :
+  m_size(size),
+  m_wordMask(bits >= 32 ? 0xffffffff : (1u << bits) - 1)
+{
+  //splitmix64, to spread the 64-bit key over the 256 bits of a ChaCha key
+  for (int k = 0; k < 4; k++)
+  {
+    key += 0x9e3779b97f4a7c15ull;
+    uint64_t z = key;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z = z ^ (z >> 31);
+    m_key[2*k] = (uint32_t) z;
+    m_key[2*k+1] = (uint32_t) (z >> 32);
+  }
+}
+
+void PairwiseMasker::PairKey(int i, int j, uint32_t key[8]) const
+{
+  //the first 8 words of the cluster key's stream for the pair (i, j), i < j
+  ChaChaStream(m_key, ((uint64_t) i << 32) | (uint32_t) j, 0, key, 8);
+}
+
+void PairwiseMasker::Mask(int index, double *values, size_t n) const
+{
+  //a chunk of entries at a time, so the streams and the sum stay in the cache
+  const size_t chunk = 4096;//a multiple of the 16 words of a ChaCha block
+  vector<uint32_t> keys((size_t) 8*m_size);
+  for (int j = 0; j < m_size; j++)
+  {
+    if (j != index)
+      PairKey(min(index, j), max(index, j), &keys[(size_t) 8*j]);
+  }
+  vector<uint32_t> stream(min(n, chunk));
+  vector<int64_t> mask(min(n, chunk));
+  for (size_t start = 0; start < n; start += chunk)
+  {
+    size_t len = min(chunk, n-start);
+    fill(mask.begin(), mask.begin()+len, 0);
+    for (int j = 0; j < m_size; j++)
+    {
+      if (j == index)
+        continue;
+      ChaChaStream(&keys[(size_t) 8*j], 0, start/16, stream.data(), len);
+      if (j > index)
+        for (size_t e = 0; e < len; e++)
+          mask[e] += stream[e] & m_wordMask;
+      else
+        for (size_t e = 0; e < len; e++)
+          mask[e] -= stream[e] & m_wordMask;
+    }
+    for (size_t e = 0; e < len; e++)
+      values[start+e] += mask[e];
+  }
+}
+
+//the router and the source are vehicles of the bitmap of the packet, so AddContributor cannot fail once
+//the values are changed; group_size bounds them further when the caller indexes betas by them
+static bool FitsIndexes(const CodedPacket &packet, int route_index, int source_index, uint32_t group_size)
+{
+  uint32_t bound = std::min(packet.GetBitmapBits(), group_size);
+  if (route_index < 0 || source_index < 0 || (uint32_t)route_index >= bound || (uint32_t)source_index >= bound)
+  {
+    CRS_LOG_DEBUG("Router " << route_index << " or source " << source_index << " outside the cluster of the packet");
+    return false;
+  }
+  return true;
+}
+
+//network coding over GF(2^8): the coefficient of a vehicle is GfCoefficient(source_index, index) in place
+//of its beta, route_symbols holds the masked values of the router as symbols
+static bool RelayEncodeField(CodedPacket &packet, int route_index, int source_index, const uint8_t *route_symbols, size_t size)
+{
+  if (!FitsIndexes(packet, route_index, source_index, CodedPacket::MAX_GROUP_SIZE))
+    return false;
+  vector<uint8_t> &symbols = packet.GetSymbols();
+  if (symbols.size() != size) //error
+  {
+    CRS_LOG_DEBUG("Error of symbols.size()!");
+    return false;
+  }
+
+  if (packet.GetType() == CodedPacket::ORIGINAL) //original packet, I am the first router
+  {
+    GfScale(symbols.data(), GfCoefficient(source_index, source_index), symbols.size());
+    packet.SetType(CodedPacket::CODED);
+    packet.AddContributor(source_index);
+  }
+  GfMulAdd(symbols.data(), route_symbols, GfCoefficient(source_index, route_index), symbols.size());
+  packet.AddContributor(route_index);
+  return true;
+}
+
+//the values as symbols, empty if one is not an integer of bytes bytes
+static vector<uint8_t> FieldSymbols(const vector<double> &values, uint8_t bytes)
+{
+  vector<uint8_t> symbols(values.size()*bytes);
+  for (size_t k = 0; k < values.size(); k++)
+  {
+    if (!CodedPacket::IntegerToSymbols(values[k], bytes, &symbols[k*bytes]))
+    {
+      CRS_LOG_DEBUG("Masked value " << values[k] << " not an integer of " << (int)bytes << " bytes");
+      return vector<uint8_t>();
+    }
+  }
+  return symbols;
+}
+
+bool RelayEncode(CodedPacket &packet, int route_index, int source_index, const vector<double> &beta, double route_mask)
+{
+  if (packet.IsField())
+  {
+    uint8_t route_symbols[8];
+    if (!CodedPacket::IntegerToSymbols(route_mask, packet.GetValueBytes(), route_symbols))
+    {
+      CRS_LOG_DEBUG("Masked value " << route_mask << " not an integer of the packet");
+      return false;
+    }
+    return RelayEncodeField(packet, route_index, source_index, route_symbols, packet.GetValueBytes());
+  }
+  if (packet.IsFixedPoint()) //the values of the router are to be quantized
+  {
+    CRS_LOG_DEBUG("A fixed-point packet is coded with the quantized values of the router (RelayEncodeQuantized)");
+    return false;
+  }
+  if (!packet.FitsGroup(beta.size()) || !FitsIndexes(packet, route_index, source_index, beta.size()))
+    return false;
+  vector<double> &values = packet.GetValues();
+  if (values.size() != 1) //error
+  {
+    CRS_LOG_DEBUG("Error of values.size()!"); 
+    return false;
+  }
+
+  if (packet.GetType() == CodedPacket::ORIGINAL) //original packet, I am the first router
+  {
+    double a_test = beta[source_index] * values[0];
+    double b_test = beta[route_index] * route_mask;
+    values[0] = a_test + b_test;
+    packet.SetType(CodedPacket::CODED);
+    packet.AddContributor(source_index);
+  }
+  else //already forwarded by others
+  {
+    values[0] = beta[route_index] * route_mask + values[0];
+  }
+  packet.AddContributor(route_index);
+  return true;
+}
+
+bool RelayEncodeInstance(CodedPacket &packet, int route_index, int source_index, const vector<double> &beta, const vector<double> &route_mask)
+{
+  if (packet.IsField())
+  {
+    vector<uint8_t> route_symbols = FieldSymbols(route_mask, packet.GetValueBytes());
+    if (route_symbols.size() != route_mask.size()*packet.GetValueBytes())
+      return false;
+    return RelayEncodeField(packet, route_index, source_index, route_symbols.data(), route_symbols.size());
+  }
+  if (packet.IsFixedPoint())
+  {
+    CRS_LOG_DEBUG("A fixed-point packet is coded with the quantized values of the router (RelayEncodeQuantized)");
+    return false;
+  }
+  if (!packet.FitsGroup(beta.size()) || !FitsIndexes(packet, route_index, source_index, beta.size()))
+    return false;
+  vector<double> &values = packet.GetValues();
+  if (values.size() != route_mask.size()) //error
+  {
+    CRS_LOG_DEBUG("Error of values.size()!"); 
+    return false;
+  }
+
+  double route_beta = beta[route_index];
+  if (packet.GetType() == CodedPacket::ORIGINAL) //original packet, I am the first router
+  {
+    // values = beta_source * values + beta_route * mask, over all the entries at once
+    CodingAxpby(values.data(), route_mask.data(), route_beta, beta[source_index], values.size());
+    packet.SetType(CodedPacket::CODED);
+    packet.AddContributor(source_index);
+  }
+  else //already forwarded by others
+  {
+    // values = values + beta_route * mask
+    CodingAxpy(values.data(), route_mask.data(), route_beta, values.size());
+  }
+  packet.AddContributor(route_index);
+  return true;
+}
+
+AlignedVector RelayContribution(double beta, const vector<double> &masked)
+{
+  AlignedVector contribution(masked.size(), 0.0);
+  CodingAxpy(contribution.data(), masked.data(), beta, masked.size());
+  return contribution;
+}
+
+bool RelayEncodeInstance(CodedPacket &packet, int route_index, int source_index, double source_beta, const AlignedVector &contribution)
+{
+  if (packet.IsField() || packet.IsFixedPoint()) //the contribution is real-valued
+  {
+    CRS_LOG_DEBUG("No contribution for a field or fixed-point packet");
+    return false;
+  }
+  if (!FitsIndexes(packet, route_index, source_index, CodedPacket::MAX_GROUP_SIZE))
+    return false;
+  vector<double> &values = packet.GetValues();
+  if (values.size() != contribution.size()) //error
+  {
+    CRS_LOG_DEBUG("Error of values.size()!"); 
+    return false;
+  }
+
+  if (packet.GetType() == CodedPacket::ORIGINAL) //original packet, I am the first router
+  {
+    // values = beta_source * values + contribution
+    CodingAxpby(values.data(), contribution.data(), 1.0, source_beta, values.size());
+    packet.SetType(CodedPacket::CODED);
+    packet.AddContributor(source_index);
+  }
+  else //already forwarded by others
+  {
+    // values = values + contribution, exact with a = 1
+    CodingAxpy(values.data(), contribution.data(), 1.0, values.size());
+  }
+  packet.AddContributor(route_index);
+  return true;
+}
+
+vector<uint8_t> RelayFieldContribution(const vector<double> &masked, uint8_t bytes)
+{
+  return FieldSymbols(masked, bytes);
+}
+
+bool RelayEncodeInstance(CodedPacket &packet, int route_index, int source_index, const vector<uint8_t> &contribution)
+{
+  if (!packet.IsField())
+  {
+    CRS_LOG_DEBUG("No field contribution for a real-valued packet");
+    return false;
+  }
+  return RelayEncodeField(packet, route_index, source_index, contribution.data(), contribution.size());
+}
+
+//the coded sums of FIXED packets stay below 2^62 in magnitude, so adding two terms never overflows int64
+static const int64_t FIXED_SUM_LIMIT = (int64_t)1 << 62;
+
+//value * factor * 2^shift, false if it would reach FIXED_SUM_LIMIT
+static bool FixedTerm(int64_t value, int64_t factor, int shift, int64_t &term)
+{
+  __int128 product = (__int128)value * factor;
+  if (product == 0)
+  {
+    term = 0;
+    return true;
+  }
+  __int128 magnitude = product < 0 ? -product : product;
+  if (shift >= 62 || magnitude >= ((__int128)FIXED_SUM_LIMIT >> shift))
+    return false;
+  term = (int64_t)(product * ((__int128)1 << shift));
+  return true;
+}
+
+//beta as an integer of FixedPointBeta, false if it is not one below 2^31
+static bool IntegerBeta(double beta, int64_t &integer)
+{
+  if (!(std::fabs(beta) < 2147483648.0) || std::trunc(beta) != beta)
+  {
+    CRS_LOG_DEBUG("Beta " << beta << " is not an integer of FixedPointBeta");
+    return false;
+  }
+  integer = (int64_t)beta;
+  return true;
+}
+
+bool RelayEncodeQuantized(CodedPacket &packet, int route_index, int source_index, const vector<double> &beta, const Quantized &route)
+{
+  if (!packet.IsFixedPoint())
+  {
+    CRS_LOG_DEBUG("Quantized values for a packet that is not fixed-point");
+    return false;
+  }
+  if (!packet.FitsGroup(beta.size()) || !FitsIndexes(packet, route_index, source_index, beta.size()))
+    return false;
+  const vector<int64_t> &integers = packet.GetIntegers();
+  if (integers.size() != route.integers.size()) //error
+  {
+    CRS_LOG_DEBUG("Error of integers.size()!");
+    return false;
+  }
+  bool original = packet.GetType() == CodedPacket::ORIGINAL;
+  int64_t route_beta, packet_beta = 1;
+  if (!IntegerBeta(beta[route_index], route_beta) || (original && !IntegerBeta(beta[source_index], packet_beta)))
+    return false;
+
+  //the sum is in units of the smaller scale, the other terms are shifted to it
+  int packet_scale = packet.GetScale();
+  int scale = min(packet_scale, (int)route.scale);
+  vector<int64_t> sums(integers.size());
+  for (size_t k = 0; k < sums.size(); k++)
+  {
+    int64_t a, b;
+    if (!FixedTerm(integers[k], packet_beta, packet_scale-scale, a) || !FixedTerm(route.integers[k], route_beta, route.scale-scale, b)
+        || a+b >= FIXED_SUM_LIMIT || a+b <= -FIXED_SUM_LIMIT)
+    {
+      CRS_LOG_DEBUG("Coded sum of entry " << k << " beyond 62 bits");
+      return false;
+    }
+    sums[k] = a+b;
+  }
+
+  if (original) //original packet, I am the first router
+  {
+    packet.SetType(CodedPacket::CODED);
+    packet.AddContributor(source_index);
+    packet.SetContributorScale(source_index, packet_scale);
+  }
+  packet.AddContributor(route_index);
+  packet.SetContributorScale(route_index, route.scale);
+  packet.SetFixedValues(scale, sums);
+  return true;
+}
+
+DenseIdMap::DenseIdMap(void)
+  :m_base(0),
+  m_values(),
+  m_size(0)
+{
+}
+
+void DenseIdMap::Insert(uint32_t key, int value)
+{
+  assert(value >= 0);
+  if (m_values.empty())
+  {
+    m_base = key;
+  }
+  else if (key < m_base)
+  {
+    m_values.insert(m_values.begin(), m_base - key, -1);
+    m_base = key;
+  }
+  uint32_t offset = key - m_base;
+  if (offset >= m_values.size())
+  {
+    m_values.resize((size_t) offset + 1, -1);
+  }
+  if (m_values[offset] < 0)
+  {
+    m_values[offset] = value;
+    m_size++;
+  }
+}
+
+int DenseIdMap::At(uint32_t key) const
+{
+  int value = Find(key);
+  if (value < 0)
+  {
+    throw out_of_range("DenseIdMap::At: no value for key " + to_string(key));
+  }
+  return value;
+}
+
+bool DenseIdMap::Empty(void) const
+{
+  return m_size == 0;
+}
+
+void DenseIdMap::Clear(void)
+{
+  m_values.clear();
+  m_base = 0;
+  m_size = 0;
+}
+
+vector<string_view> split(string_view str, string_view pattern)
+{
+    vector<string_view> res;
+    if(str.empty())
+        return res;
+
+    size_t start = 0;
+    size_t pos = str.find(pattern);
+    while(pos != str.npos)
+    {
+        res.push_back(str.substr(start, pos-start));
+        start = pos+pattern.size();
+        pos = str.find(pattern, start);
+    }
+    res.push_back(str.substr(start));
+
+    return res;
+}
+
+bool ParseNumber(string_view token, double &value)
+{
+    const char *end = token.data()+token.size();
+    from_chars_result r = from_chars(token.data(), end, value);
+    return !token.empty() && r.ec == errc() && r.ptr == end;
+}
+
+bool ParseNumber(string_view token, int &value)
+{
+    const char *end = token.data()+token.size();
+    from_chars_result r = from_chars(token.data(), end, value);
+    return !token.empty() && r.ec == errc() && r.ptr == end;
+}
+
+
+DataManagementHelper::DataManagementHelper(int num_obser, const vector<double> &beta, int entries)//num_obser_expected = group_size-1 = center+others
+  :
+  num_obser_expected(num_obser),
+  vehicle_beta(beta),
+  num_entries(entries),
+  keep_batch(false),
+  obser_list(vector<double>(num_obser+1, -100)),
+  obser_list_instance(vector<vector<double>>(num_obser+1, vector<double>(num_entries, -100))), 
+  coef(),
+  coef_instance(),
+  values_instance(),
+  coef_batch(),
+  rhs_batch(),
+  vehicle_id_can_calculate(),
+  online_num_values(0),
+  online_functions(),
+  online_pivot(),
+  online_recovered(num_obser+1, -1),
+  online_num_recovered(0),
+  online_value_bytes(0),
+  online_field_functions(),
+  online_fixed_functions(),
+  online_scale(num_obser+1, INT_MIN)
+{
+}
+
+vector<double> DataManagementHelper::GetObserList()
+{
+	return obser_list;
+}
+
+vector <vector<double>> DataManagementHelper::GetObserListInstance()
+{
+  return obser_list_instance;
+}
+
+void DataManagementHelper::AddObserList (double ob_value, int vehicle_id)
+{
+	obser_list[vehicle_id] = ob_value;
+}
+
+void DataManagementHelper::AddObserListInstance (double ob_value, int vehicle_id)
+{
+  obser_list_instance[vehicle_id].push_back(ob_value);
+}
+
+bool DataManagementHelper::FitsCluster (const CodedPacket &packet, int vehicle_id) const
+{
+  //the betas only index the contributors of real-valued packets
+  size_t group_size = num_obser_expected+1;
+  if (!packet.IsField())
+    group_size = std::min(group_size, vehicle_beta.size());
+  if (vehicle_id < 0 || (size_t)vehicle_id > (size_t)num_obser_expected)
+  {
+    CRS_LOG_DEBUG("Packet of vehicle " << vehicle_id << " outside the cluster dropped");
+    return false;
+  }
+  if (packet.GetType() != CodedPacket::CODED)
+    return true;
+  vector<uint32_t> passed_vehicles = packet.GetContributors();
+  for (size_t i=0; i<passed_vehicles.size(); ++i)
+  {
+    if (passed_vehicles[i] >= group_size)
+    {
+      CRS_LOG_DEBUG("Packet with contributor " << passed_vehicles[i] << " outside the cluster of " << group_size << " vehicles dropped");
+      return false;
+    }
+  }
+  return true;
+}
+
+void DataManagementHelper::MessageHandle (const CodedPacket &packet, int vehicle_id)
+{
+	if (!FitsCluster(packet, vehicle_id))
+		return;
+	if (packet.IsField())
+	{
+		if (MessageHandleField(packet, vehicle_id, 1) && packet.GetType() == CodedPacket::ORIGINAL)
+			AddObserList(packet.GetFieldValues()[0], vehicle_id);
+		return;
+	}
+	if (packet.IsFixedPoint())
+	{
+		if (MessageHandleFixed(packet, vehicle_id, 1) && packet.GetType() == CodedPacket::ORIGINAL)
+			AddObserList(packet.GetFixedValues()[0], vehicle_id);
+		return;
+	}
+	const vector<double> &values = packet.GetValues();
+	if (values.size() != 1)
+	{
+		CRS_LOG_DEBUG("Unexpected number of values: " << values.size());
+		return;
+	}
+	if (packet.GetType() == CodedPacket::ORIGINAL)//original packet
+	{
+		AddObserList(values[0], vehicle_id);
+		vector<double> one_function(num_obser_expected+2,0);
+		one_function[vehicle_id] = 1;
+		one_function.back() = values[0];
+		OnlineAdd(one_function);
+	}else if (packet.GetType() == CodedPacket::CODED)//forwarded by others
+	{
+		vector<double> one_function(num_obser_expected+2,0);
+		//passed-vehicles, the bitmap already carries their indexes
+		vector<uint32_t> passed_vehicles = packet.GetContributors();
+
+		for (size_t i=0; i<passed_vehicles.size(); ++i)
+		{
+			one_function[passed_vehicles[i]] = vehicle_beta[passed_vehicles[i]];
+		}
+		one_function.back() = values[0];
+		coef.push_back (one_function);
+		OnlineAdd(one_function);
+	}
+}
+
+void DataManagementHelper::MessageHandleInstance (const CodedPacket &packet, int vehicle_id)
+{
+  if (!FitsCluster(packet, vehicle_id))
+    return;
+  if (packet.IsField())
+  {
+    if (MessageHandleField(packet, vehicle_id, num_entries) && packet.GetType() == CodedPacket::ORIGINAL)
+      obser_list_instance[vehicle_id] = packet.GetFieldValues();
+    return;
+  }
+  if (packet.IsFixedPoint())
+  {
+    if (MessageHandleFixed(packet, vehicle_id, num_entries) && packet.GetType() == CodedPacket::ORIGINAL)
+      obser_list_instance[vehicle_id] = packet.GetFixedValues();
+    return;
+  }
+  const vector<double> &values = packet.GetValues();
+  if (values.size() != (size_t)num_entries)
+  {
+    CRS_LOG_DEBUG("Unexpected number of entries: " << values.size());
+    return;
+  }
+  if (packet.GetType() == CodedPacket::ORIGINAL) //original packet, I am the first router
+  {
+    obser_list_instance[vehicle_id] = values;
+    vector<double> one_function(num_obser_expected+1,0);
+    one_function[vehicle_id] = 1;
+    one_function.insert(one_function.end(), values.begin(), values.end());
+    OnlineAdd(one_function);
+  }else if (packet.GetType() == CodedPacket::CODED)//forwarded by others
+  {
+    CRS_LOG_DEBUG("Forwared Packet");
+    //one coefficient row per packet, the entries go to the value matrix
+    vector<double> one_function(num_obser_expected+1,0);
+    vector<uint32_t> passed_vehicles = packet.GetContributors();
+    for (size_t i=0; i<passed_vehicles.size(); ++i)
+    {
+      one_function[passed_vehicles[i]] = vehicle_beta[passed_vehicles[i]];
+    }
+    if (keep_batch)
+    {
+      coef_instance.push_back (one_function);
+      values_instance.insert (values_instance.end(), values.begin(), values.end());
+    }
+    one_function.insert(one_function.end(), values.begin(), values.end());
+    OnlineAdd(one_function);
+  }
+
+
+}
+
+bool DataManagementHelper::MessageHandleField (const CodedPacket &packet, int vehicle_id, int entries)
+{
+  const vector<uint8_t> &symbols = packet.GetSymbols();
+  if (symbols.size() != (size_t)entries*packet.GetValueBytes()
+      || (online_value_bytes != 0 && online_value_bytes != packet.GetValueBytes()) || !online_fixed_functions.empty())
+  {
+    CRS_LOG_DEBUG("Unexpected field packet: " << symbols.size() << " symbols of " << (int)packet.GetValueBytes() << " bytes");
+    return false;
+  }
+  online_value_bytes = packet.GetValueBytes();
+  vector<uint8_t> one_function(num_obser_expected+1,0);
+  if (packet.GetType() == CodedPacket::ORIGINAL)
+  {
+    one_function[vehicle_id] = 1;
+  }else if (packet.GetType() == CodedPacket::CODED)
+  {
+    vector<uint32_t> passed_vehicles = packet.GetContributors();
+    for (size_t i=0; i<passed_vehicles.size(); ++i)
+    {
+      one_function[passed_vehicles[i]] = GfCoefficient(vehicle_id, passed_vehicles[i]);
+    }
+  }else
+  {
+    return false;
+  }
+  one_function.insert(one_function.end(), symbols.begin(), symbols.end());
+  OnlineAddField(one_function);
+  return true;
+}
+
+//arithmetic modulo the prime 2^61-1 of the FIXED packets at the head; 2^61 = 1, so the
+//high bits of a product fold onto the low ones
+static const uint64_t FIXED_PRIME = ((uint64_t)1 << 61) - 1;
+
+static uint64_t ModPrime(unsigned __int128 x)
+{
+  x = (x & FIXED_PRIME) + (x >> 61);
+  x = (x & FIXED_PRIME) + (x >> 61);
+  return x >= FIXED_PRIME ? (uint64_t)x - FIXED_PRIME : (uint64_t)x;
+}
+
+static uint64_t MulModPrime(uint64_t a, uint64_t b)
+{
+  return ModPrime((unsigned __int128)a * b);
+}
+
+static uint64_t ToModPrime(int64_t v)
+{
+  uint64_t r = (uint64_t)(v < 0 ? -v : v) % FIXED_PRIME;
+  return (v < 0 && r != 0) ? FIXED_PRIME - r : r;
+}
+
+//the integer of residue r between -(p-1)/2 and (p-1)/2
+static int64_t FromModPrime(uint64_t r)
+{
+  return r > FIXED_PRIME/2 ? (int64_t)r - (int64_t)FIXED_PRIME : (int64_t)r;
+}
+
+//a^(p-2), the inverse of a non-zero residue
+static uint64_t InvModPrime(uint64_t a)
+{
+  uint64_t result = 1;
+  for (uint64_t e = FIXED_PRIME-2; e > 0; e >>= 1)
+  {
+    if (e & 1)
+      result = MulModPrime(result, a);
+    a = MulModPrime(a, a);
+  }
+  return result;
+}
+
+bool DataManagementHelper::MessageHandleFixed (const CodedPacket &packet, int vehicle_id, int entries)
+{
+  const vector<int64_t> &integers = packet.GetIntegers();
+  if (integers.size() != (size_t)entries || online_value_bytes != 0 || !online_functions.empty())
+  {
+    CRS_LOG_DEBUG("Unexpected fixed-point packet: " << integers.size() << " integers");
+    return false;
+  }
+  //the coefficient of a vehicle is its integer beta times 2 to the power of its scale over the
+  //scale of the packet, which the relays made the smallest one, so it is an integer too
+  vector<uint64_t> one_function(num_obser_expected+1,0);
+  vector<int> scales = online_scale;
+  if (packet.GetType() == CodedPacket::ORIGINAL)
+  {
+    one_function[vehicle_id] = 1;
+    if (scales[vehicle_id] != INT_MIN && scales[vehicle_id] != packet.GetScale())
+    {
+      CRS_LOG_DEBUG("Vehicle " << vehicle_id << " quantized with scale " << (int)packet.GetScale() << ", " << scales[vehicle_id] << " before");
+      return false;
+    }
+    scales[vehicle_id] = packet.GetScale();
+  }else if (packet.GetType() == CodedPacket::CODED)
+  {
+    vector<uint32_t> passed_vehicles = packet.GetContributors();
+    for (size_t i=0; i<passed_vehicles.size(); ++i)
+    {
+      uint32_t v = passed_vehicles[i];
+      int scale = packet.GetContributorScale(v);
+      int64_t beta;
+      if (!IntegerBeta(vehicle_beta[v], beta) || scale < packet.GetScale()
+          || (scales[v] != INT_MIN && scales[v] != scale))
+      {
+        CRS_LOG_DEBUG("Contributor " << v << " with scale " << scale << " in a packet of scale " << (int)packet.GetScale());
+        return false;
+      }
+      scales[v] = scale;
+      //2^61 = 1 modulo the prime
+      uint64_t shift = (uint64_t)1 << ((scale-packet.GetScale()) % 61);
+      one_function[v] = MulModPrime(ToModPrime(beta), shift);
+    }
+  }else
+  {
+    return false;
+  }
+  online_scale.swap(scales);
+  for (int64_t v : integers)
+    one_function.push_back(ToModPrime(v));
+  OnlineAddFixed(one_function);
+  return true;
+}
+
+vector<vector<double> > DataManagementHelper::GetCoef()
+{
+	return coef;
+}
+
+void DataManagementHelper::SetKeepBatch (bool keep)
+{
+  keep_batch = keep;
+}
+
+vector<vector<double> > DataManagementHelper::GetCoefInstance()
+{
+  return coef_instance;
+}
+
+const vector<double> &DataManagementHelper::GetValuesInstance()
+{
+  return values_instance;
+}
+
+void DataManagementHelper::FunctionsClean ()
+{
+	size_t i,j;
+    // rows
+    for (i = 0; i < coef.size(); i++)
+    {
+        for(j = 0; j < coef[0].size()-1; j++)
+        {
+        	if ((coef[i][j] != 0) && (obser_list[j] != -100)) // we already known the observation value, so remove it
+        	{
+        		coef[i].back() = coef[i].back() - coef[i][j]*obser_list[j];
+                if (abs(coef[i].back() - 0) < 0.0001) 
+                    coef[i].back() = 0;
+        		coef[i][j] = 0;
+        	}
+        }
+
+    }
+
+
+    vector<vector<double> > coef_1;
+
+ 	for (i = 0; i < coef.size(); i++)
+    {
+        if ( !all_of(coef[i].begin(), coef[i].end(), [](double i) { return abs(i-0.0)<= 0.000001; }))
+        {
+        	coef_1.push_back(coef[i]);
+        }
+    }
+
+    if (coef_1.empty())
+    {
+        coef.assign(coef_1.begin(), coef_1.end());
+        return;
+    }
+
+
+
+    vector <vector<double> > coef_2 (coef_1.size(),vector<double>(1, 0));
+
+    for (j=0;j<coef_1[0].size()-1; j++)
+    {
+    	 for (size_t i=0; i<coef_1.size(); i++)
+    	 {
+    	 	
+    	 	if ( abs(coef_1[i][j]-0.0) > 0.000001 )
+    	 	{
+    	 		for (size_t line=0; line<coef_1.size(); line++)
+    	 		{
+    	 			coef_2[line].insert(coef_2[line].end()-1, coef_1[line][j]);
+    	 		}
+                vehicle_id_can_calculate.push_back(j);
+    	 		break;
+    	 	}
+    	 }
+    }
+    for (size_t line=0; line<coef_1.size(); line++)
+    {
+    	coef_2[line][coef_2[0].size()-1] = coef_1[line][coef_1[0].size()-1];//the last column
+    }
+
+    coef_2.erase(std::unique(coef_2.begin(), coef_2.end()), coef_2.end());//remove the duplicated functions
+
+    if (coef_2.empty())
+    {
+        coef.assign(coef_2.begin(), coef_2.end());
+        return;
+    }
+
+
+    coef.assign(coef_2.begin(), coef_2.end());
+
+    //now to clean the columns
+
+}
+
+
+
+void DataManagementHelper::FunctionsCleanInstance ()
+{
+  //the coefficients of a packet are the same for every entry, so the functions
+  //are cleaned once and the entries are kept as the right-hand side columns
+  coef_batch.clear();
+  rhs_batch.clear();
+  vehicle_id_can_calculate.clear();
+  if (coef_instance.empty())
+    return;
+
+  int rows = coef_instance.size();
+  int cols = coef_instance[0].size();
+  vector<vector<double> > current_coef = coef_instance;
+  vector<double> current_rhs = values_instance;
+
+  // rows
+  for (int i = 0; i < rows; i++)
+  {
+    for (int j = 0; j < cols; j++)
+    {
+      if ((current_coef[i][j] != 0) && (obser_list_instance[j][0] != -100)) // we already known the observation values, so remove them
+      {
+        CodingAxpy(&current_rhs[(size_t)i*num_entries], obser_list_instance[j].data(), -current_coef[i][j], num_entries);
+        current_coef[i][j] = 0;
+      }
+    }
+  }
+
+  vector<bool> keep_column(cols, false);
+  for (int i = 0; i < rows; i++)
+  {
+    bool empty_row = true;
+    for (int j = 0; j < cols; j++)
+    {
+      if (abs(current_coef[i][j]) > 0.000001)
+      {
+        keep_column[j] = true;
+        empty_row = false;
+      }
+    }
+    if (empty_row)
+      continue;
+    coef_batch.push_back(current_coef[i]);
+    rhs_batch.insert(rhs_batch.end(), current_rhs.begin()+(size_t)i*num_entries, current_rhs.begin()+(size_t)(i+1)*num_entries);
+  }
+
+  //now to clean the columns
+  for (int j = 0; j < cols; j++)
+  {
+    if (keep_column[j])
+      vehicle_id_can_calculate.push_back(j);
+  }
+  for (size_t i = 0; i < coef_batch.size(); i++)
+  {
+    vector<double> row(vehicle_id_can_calculate.size());
+    for (size_t k = 0; k < vehicle_id_can_calculate.size(); k++)
+      row[k] = coef_batch[i][vehicle_id_can_calculate[k]];
+    coef_batch[i].swap(row);
+  }
+}
+
+vector<vector<double> > DataManagementHelper::GetCoefBatch()
+{
+  return coef_batch;
+}
+
+const vector<double> &DataManagementHelper::GetRhsBatch()
+{
+  return rhs_batch;
+}
+
+
+void DataManagementHelper::OnlineAdd (vector<double> &function)
+{
+  //keep the functions received so far in reduced row echelon form, so a new
+  //function costs one pass over the rows instead of a full elimination
+  int num_v = num_obser_expected+1;
+  if (online_num_values == 0)
+    online_num_values = function.size()-num_v;
+  int width = num_v+online_num_values;
+  if (function.size() != (size_t)width)
+  {
+    CRS_LOG_DEBUG("Function with " << function.size() << " values, expected " << width);
+    return;
+  }
+
+  double *f = function.data();
+  double largest = 0;
+  for (int k = 0; k < num_v; k++)
+    largest = max(largest, abs(f[k]));
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    double c = f[online_pivot[i]];
+    if (c != 0)
+    {
+      CodingAxpy(f, &online_functions[(size_t)i*width], -c, width);
+      f[online_pivot[i]] = 0;
+    }
+  }
+
+  int col = -1;
+  double tol = 1e-9*max(1.0, largest);
+  for (int k = 0; k < num_v; k++)
+  {
+    if (abs(f[k]) > tol && (col < 0 || abs(f[k]) > abs(f[col])))
+      col = k;
+  }
+  if (col < 0)
+  {
+    CRS_LOG_DEBUG("Redundant function, rank stays " << online_pivot.size());
+    return;
+  }
+  CodingAxpby(f, f, 0, 1.0/f[col], width);
+  f[col] = 1;
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    double *r = &online_functions[(size_t)i*width];
+    if (r[col] != 0)
+    {
+      CodingAxpy(r, f, -r[col], width);
+      r[col] = 0;
+    }
+  }
+  online_functions.insert(online_functions.end(), function.begin(), function.end());
+  online_pivot.push_back(col);
+
+  //a vehicle is known once its row has no other vehicle left
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    if (online_recovered[online_pivot[i]] >= 0)
+      continue;
+    const double *r = &online_functions[(size_t)i*width];
+    bool tag = true;
+    for (int k = 0; k < num_v && tag; k++)
+      if (k != online_pivot[i] && abs(r[k]) > tol)
+        tag = false;
+    if (tag)
+    {
+      online_recovered[online_pivot[i]] = i;
+      online_num_recovered++;
+    }
+  }
+}
+
+void DataManagementHelper::OnlineAddField (vector<uint8_t> &function)
+{
+  //OnlineAdd over GF(2^8): no rounding, so a function is redundant only if it is reduced to 0
+  int num_v = num_obser_expected+1;
+  if (online_num_values == 0)
+    online_num_values = function.size()-num_v;
+  int width = num_v+online_num_values;
+  if (function.size() != (size_t)width)
+  {
+    CRS_LOG_DEBUG("Function with " << function.size() << " symbols, expected " << width);
+    return;
+  }
+
+  uint8_t *f = function.data();
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    //subtracting is adding in GF(2^8), and clears f[online_pivot[i]]
+    GfMulAdd(f, &online_field_functions[(size_t)i*width], f[online_pivot[i]], width);
+  }
+
+  int col = -1;
+  for (int k = 0; k < num_v && col < 0; k++)
+  {
+    if (f[k] != 0)
+      col = k;
+  }
+  if (col < 0)
+  {
+    CRS_LOG_DEBUG("Redundant function, rank stays " << online_pivot.size());
+    return;
+  }
+  GfScale(f, GfInv(f[col]), width);
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    uint8_t *r = &online_field_functions[(size_t)i*width];
+    GfMulAdd(r, f, r[col], width);
+  }
+  online_field_functions.insert(online_field_functions.end(), function.begin(), function.end());
+  online_pivot.push_back(col);
+
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    if (online_recovered[online_pivot[i]] >= 0)
+      continue;
+    const uint8_t *r = &online_field_functions[(size_t)i*width];
+    bool tag = true;
+    for (int k = 0; k < num_v && tag; k++)
+      if (k != online_pivot[i] && r[k] != 0)
+        tag = false;
+    if (tag)
+    {
+      online_recovered[online_pivot[i]] = i;
+      online_num_recovered++;
+    }
+  }
+}
+
+void DataManagementHelper::OnlineAddFixed (vector<uint64_t> &function)
+{
+  //OnlineAdd modulo the prime: exact, so a function is redundant only if it is reduced to 0
+  int num_v = num_obser_expected+1;
+  if (online_num_values == 0)
+    online_num_values = function.size()-num_v;
+  int width = num_v+online_num_values;
+  if (function.size() != (size_t)width)
+  {
+    CRS_LOG_DEBUG("Function with " << function.size() << " integers, expected " << width);
+    return;
+  }
+
+  uint64_t *f = function.data();
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    uint64_t c = f[online_pivot[i]];
+    if (c == 0)
+      continue;
+    const uint64_t *r = &online_fixed_functions[(size_t)i*width];
+    for (int k = 0; k < width; k++)
+    {
+      uint64_t t = MulModPrime(c, r[k]);
+      f[k] = f[k] >= t ? f[k]-t : f[k]+FIXED_PRIME-t;
+    }
+  }
+
+  int col = -1;
+  for (int k = 0; k < num_v && col < 0; k++)
+  {
+    if (f[k] != 0)
+      col = k;
+  }
+  if (col < 0)
+  {
+    CRS_LOG_DEBUG("Redundant function, rank stays " << online_pivot.size());
+    return;
+  }
+  uint64_t inverse = InvModPrime(f[col]);
+  for (int k = 0; k < width; k++)
+    f[k] = MulModPrime(f[k], inverse);
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    uint64_t *r = &online_fixed_functions[(size_t)i*width];
+    uint64_t c = r[col];
+    if (c == 0)
+      continue;
+    for (int k = 0; k < width; k++)
+    {
+      uint64_t t = MulModPrime(c, f[k]);
+      r[k] = r[k] >= t ? r[k]-t : r[k]+FIXED_PRIME-t;
+    }
+  }
+  online_fixed_functions.insert(online_fixed_functions.end(), function.begin(), function.end());
+  online_pivot.push_back(col);
+
+  for (size_t i = 0; i < online_pivot.size(); i++)
+  {
+    if (online_recovered[online_pivot[i]] >= 0)
+      continue;
+    const uint64_t *r = &online_fixed_functions[(size_t)i*width];
+    bool tag = true;
+    for (int k = 0; k < num_v && tag; k++)
+      if (k != online_pivot[i] && r[k] != 0)
+        tag = false;
+    if (tag)
+    {
+      online_recovered[online_pivot[i]] = i;
+      online_num_recovered++;
+    }
+  }
+}
+
+vector<int> DataManagementHelper::GetRecoveredSet()
+{
+  vector<int> recovered;
+  for (size_t i = 0; i < online_recovered.size(); i++)
+  {
+    if (online_recovered[i] >= 0)
+      recovered.push_back(i);
+  }
+  return recovered;
+}
+
+vector<double> DataManagementHelper::GetRecoveredValues(int vehicle_id)
+{
+  if (online_recovered[vehicle_id] < 0)
+    return vector<double>();
+  int num_v = num_obser_expected+1;
+  if (online_value_bytes > 0)
+  {
+    const uint8_t *symbols = &online_field_functions[(size_t)online_recovered[vehicle_id]*(num_v+online_num_values)+num_v];
+    vector<double> values(online_num_values/online_value_bytes);
+    for (size_t k = 0; k < values.size(); k++)
+      values[k] = CodedPacket::SymbolsToInteger(symbols+k*online_value_bytes, online_value_bytes);
+    return values;
+  }
+  if (!online_fixed_functions.empty())
+  {
+    //the quantized integers are below 2^31, the residues of the row are theirs
+    const uint64_t *integers = &online_fixed_functions[(size_t)online_recovered[vehicle_id]*(num_v+online_num_values)+num_v];
+    vector<double> values(online_num_values);
+    for (size_t k = 0; k < values.size(); k++)
+      values[k] = std::ldexp((double)FromModPrime(integers[k]), online_scale[vehicle_id]);
+    return values;
+  }
+  vector<double>::const_iterator r = online_functions.begin()+(size_t)online_recovered[vehicle_id]*(num_v+online_num_values);
+  return vector<double>(r+num_v, r+num_v+online_num_values);
+}
+
+bool DataManagementHelper::IsRecoveryComplete()
+{
+  return online_num_recovered >= num_obser_expected;
+}
+
+vector<int> DataManagementHelper::GetID_Map()
+{
+    return vehicle_id_can_calculate;
+};
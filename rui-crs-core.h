@@ -0,0 +1,253 @@
+#ifndef RUI_CRS_CORE_H
+#define RUI_CRS_CORE_H
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include <string_view>
+#include "rui-crs-packet.h"
+
+/*
+ * Rui: the CRS coding core, without ns-3: masking, the encoding at a relay,
+ * the bookkeeping and the decoding at the head. The cluster (betas, masks,
+ * entries) is passed in, so the same code runs in the simulations, the
+ * benchmarks and on a vehicle. Built as the crs-core library by CMakeLists.txt.
+ */
+
+/// Rui: mask the observation of the vehicle at index in a cluster of size vehicles.
+/// The masks of all vehicles sum to 0. The masks can be chosen with a more complex method.
+int MaskObservation(int raw_obser, int index, int size);
+/// Rui: the mask MaskObservation adds for each of the size vehicles, all computed in O(size)
+std::vector<int> MaskOffsets(int size);
+/// Rui: MaskObservation on n observations at once, given the offset of the vehicle from
+/// MaskOffsets: values[k] = (int) values[k] + offset, in one vector pass.
+void MaskObservations(double *values, std::size_t n, int offset);
+
+/**
+ * \brief Pairwise masks expanded by a stream cipher.
+ *
+ * Vehicles i < j share the stream of their pair: i adds it to its values and
+ * j subtracts it, so the masks of the cluster cancel in every entry of the
+ * sum at the head, while each masked value alone looks random. The stream of
+ * a pair is ChaCha12 (rui-chacha.h) under the key of the pair, one word per
+ * entry cut to bits bits. The masks are integers, so they cancel exactly in
+ * double as long as size * 2^bits stays far below 2^53.
+ *
+ * Here the pair keys are derived from one cluster key (PairKey); on the
+ * vehicles, each pair would agree on its key instead (e.g. ECDH). Use a new
+ * key for every round.
+ */
+class PairwiseMasker
+{
+public:
+  PairwiseMasker (uint64_t key, int size, int bits);
+
+  /// Add the mask of the vehicle at index to the n values, entry k getting word k of the pair streams
+  void Mask (int index, double *values, std::size_t n) const;
+
+private:
+  void PairKey (int i, int j, uint32_t key[8]) const;
+
+  uint32_t m_key[8];
+  int m_size;
+  uint32_t m_wordMask;
+};
+
+/// Rui: the betas as integers, round(beta * 2^bits), for fixed-point coding. The relays
+/// multiply the quantized values by them in int64 (RelayEncodeQuantized).
+std::vector<double> FixedPointBeta(const std::vector<double> &beta, int bits);
+/// Rui: bytes an integer needs in a cluster of size vehicles whose values stay within
+/// +-max_value and integer betas within max_beta, e.g. the GF(2^8) symbols of the masked
+/// values (CodedPacket::SetFieldValues). 0 if it could reach 2^53 and not be exact in double.
+int FixedPointBytes(double max_value, double max_beta, int size);
+
+/// Rui: values quantized for the fixed-point mode: values[k] is about integers[k] * 2^scale,
+/// at most 2^(scale-1) away
+struct Quantized
+{
+  int8_t scale;
+  std::vector<int64_t> integers;
+};
+/// Rui: quantize values to signed integers of bits bits (2 to 32; 8 or 16 in the programs),
+/// with the smallest scale at which the largest |value| still fits. false if a value is not
+/// finite or the scale would leave int8.
+bool Quantize(const std::vector<double> &values, int bits, Quantized &quantized);
+
+/// Rui: allocator of 64-byte aligned storage, so the vector kernels read whole cache lines
+template <class T>
+struct AlignedAllocator
+{
+  typedef T value_type;
+  AlignedAllocator () = default;
+  template <class U> AlignedAllocator (const AlignedAllocator<U> &) {}
+  T *allocate (std::size_t n) { return static_cast<T *> (::operator new (n * sizeof (T), std::align_val_t (64))); }
+  void deallocate (T *p, std::size_t) { ::operator delete (p, std::align_val_t (64)); }
+  template <class U> bool operator== (const AlignedAllocator<U> &) const { return true; }
+  template <class U> bool operator!= (const AlignedAllocator<U> &) const { return false; }
+};
+typedef std::vector<double, AlignedAllocator<double> > AlignedVector;
+
+/// Rui: what a router adds to every packet it codes, beta * masked entries, fixed for a round
+AlignedVector RelayContribution(double beta, const std::vector<double> &masked);
+
+/// Rui: network coding at a router, done in place on the value of the packet.
+/// route_mask is the masked observation of the router. A FIELD packet is coded over
+/// GF(2^8) with the coefficients GfCoefficient (source_index, index) in place of the betas.
+/// Returns false if the packet does not carry one value, or if route_mask is not an
+/// integer that fits the bytes of a FIELD packet.
+bool RelayEncode(CodedPacket &packet, int route_index, int source_index, const std::vector<double> &beta, double route_mask);
+/// Same for an instance packet, route_mask holds the masked entries of the router.
+/// Returns false if the packet does not carry route_mask.size () entries, or if an entry
+/// does not fit the bytes of a FIELD packet.
+bool RelayEncodeInstance(CodedPacket &packet, int route_index, int source_index, const std::vector<double> &beta, const std::vector<double> &route_mask);
+/// Same with the contribution of the router from RelayContribution, so only the source
+/// beta is applied per packet. Returns false if the packet does not carry contribution.size () entries.
+bool RelayEncodeInstance(CodedPacket &packet, int route_index, int source_index, double source_beta, const AlignedVector &contribution);
+/// Rui: the same for FIELD packets, the masked entries as symbols of bytes bytes, empty if an entry is not
+/// an integer that fits bytes bytes. Their coefficient depends on the source, so it is applied per packet.
+std::vector<uint8_t> RelayFieldContribution(const std::vector<double> &masked, uint8_t bytes);
+/// Returns false if the packet is not a FIELD packet of contribution.size () symbols.
+bool RelayEncodeInstance(CodedPacket &packet, int route_index, int source_index, const std::vector<uint8_t> &contribution);
+/// Rui: network coding of a FIXED packet (CodedPacket::SetFixedValues), single or instance, in int64.
+/// route holds the quantized masked values of the router and beta the integer betas (FixedPointBeta).
+/// The packet and the router terms are brought to the smaller of their scales by shifting, so the sum
+/// stays exact, and the scale of each contributor goes with the packet for the head. Returns false,
+/// leaving the packet as it was, if it is not a FIXED packet of route.integers.size () entries, a beta
+/// is not an integer below 2^31, or a sum would reach 2^62.
+bool RelayEncodeQuantized(CodedPacket &packet, int route_index, int source_index, const std::vector<double> &beta, const Quantized &route);
+
+class DataRecoveryHelper
+{
+public:
+    DataRecoveryHelper (void);
+    std::vector<double> GetResults();
+    std::vector<std::vector<double> > GetResultsBatch();//one result vector per right-hand side
+    std::vector<bool> GetSolved();//which results are uniquely determined by the functions
+    int GetRank();
+    void SetParameters(int num_v, int num_f, std::vector<std::vector<double> > coe);//for decoding calculation
+    void SetParametersBatch(int num_v, int num_f, const std::vector<std::vector<double> > &coe, const std::vector<double> &rhs, int num_rhs);//same coefficients, rhs holds num_rhs values per function
+    void pc();//for calculation
+
+
+private:
+
+    void Reset(int num_v, int num_f, int num_rhs);
+    void SwapRows(int a, int b);
+    void Eliminate(int row, int col);//make m[row][col] the pivot and clear the column in the other rows
+    double Tolerance();
+
+    int N;//number of variables
+    int M;//number of functions
+    int K;//number of right-hand sides
+    int rank;
+    std::vector<std::vector<double> > s;//Result, one vector per right-hand side
+    std::vector<bool> solved;
+    std::vector<double> m;//all coefficients, M rows of N+K values stored row after row
+    std::vector<int> pivot_col;//pivot column of each row, -1 if none
+};
+
+/**
+ * \brief Map from IDs to indexes, stored as an array.
+ *
+ * The keys (node IDs, IPv4 addresses as numbers) of a simulation are a few
+ * consecutive numbers, so the values are kept in an array from the smallest
+ * key to the largest and a lookup is one subtraction and one load, in place
+ * of the walk down a std::map that the relays did at every hop.
+ */
+class DenseIdMap
+{
+public:
+  DenseIdMap (void);
+  /// Keep value for key, unless key already has a value (as std::map::insert)
+  void Insert (uint32_t key, int value);
+  /// The value of key, -1 if it has none
+  int Find (uint32_t key) const
+  {
+    uint32_t offset = key - m_base;
+    return offset < m_values.size () ? m_values[offset] : -1;
+  }
+  /// The value of key, throws std::out_of_range if it has none (as std::map::at)
+  int At (uint32_t key) const;
+  bool Empty (void) const;
+  void Clear (void);
+
+private:
+  uint32_t m_base; //smallest key
+  std::vector<int> m_values; //value of key m_base + i, -1 if none
+  std::size_t m_size;
+};
+
+// Rui:Split， pattern is the split flag. The tokens point into str, so keep str alive while using them
+std::vector<std::string_view> split(std::string_view str, std::string_view pattern);
+// Rui: parse a whole token as a number, false if it is empty or has anything else in it
+bool ParseNumber(std::string_view token, double &value);
+bool ParseNumber(std::string_view token, int &value);
+
+class DataManagementHelper
+{
+public:
+    //beta: the beta of each vehicle of the cluster, integers (FixedPointBeta) for FIXED packets,
+    //entries: the entries of an instance
+    DataManagementHelper (int num_obser, const std::vector<double> &beta, int entries);
+    std::vector<double> GetObserList();
+    std::vector <std::vector<double>> GetObserListInstance();
+    void AddObserList (double ob_value, int vehicle_id);
+    void AddObserListInstance (double ob_value, int vehicle_id);
+    //vehicle_id: the cluster index of the source of the packet, which also gives the GF(2^8) coefficients
+    void MessageHandle (const CodedPacket &packet, int vehicle_id);
+    void MessageHandleInstance (const CodedPacket &packet, int vehicle_id);
+    //keep the coded instance functions for FunctionsCleanInstance and the batch solve; off by
+    //default, as the programs decode online and only the benchmarks time the batch path
+    void SetKeepBatch (bool keep);
+    void FunctionsClean ();
+    void FunctionsCleanInstance ();
+    std::vector<std::vector<double> > GetCoef();
+    std::vector<std::vector<double> > GetCoefInstance();//one coefficient row per coded packet
+    const std::vector<double> &GetValuesInstance();//num_entries values per coded packet, packet after packet
+    std::vector<std::vector<double> > GetCoefBatch();//instance coefficients after FunctionsCleanInstance
+    const std::vector<double> &GetRhsBatch();//num_entries values per function, function after function
+    std::vector<int> GetID_Map();
+    //online decoding, updated by MessageHandle/MessageHandleInstance as packets arrive
+    std::vector<int> GetRecoveredSet();//vehicles whose values are known, received or decoded
+    //empty if the vehicle is not known yet; exact integers over GF(2^8), and exactly the quantized values
+    //(integers * 2^scale) the vehicle sent in FIXED packets
+    std::vector<double> GetRecoveredValues(int vehicle_id);
+    bool IsRecoveryComplete();//all num_obser_expected members are known
+private:
+    //false, logging the drop, if the source or a contributor of the packet is not a vehicle of the cluster,
+    //e.g. a bit past the cluster in the last byte of the bitmap read from the wire
+    bool FitsCluster (const CodedPacket &packet, int vehicle_id) const;
+    void OnlineAdd (std::vector<double> &function);//function: the coefficients of all vehicles followed by the values
+    //FIELD packets (CodedPacket::SetFieldValues) go to the online decoding over GF(2^8) only, not to the batch functions
+    bool MessageHandleField (const CodedPacket &packet, int vehicle_id, int entries);
+    void OnlineAddField (std::vector<uint8_t> &function);//function: the GF(2^8) coefficients followed by the symbols
+    //FIXED packets (CodedPacket::SetFixedValues) go to an online decoding modulo the prime 2^61-1: the integers the
+    //vehicles quantized are below 2^31, so they are the only ones of their residues and are recovered exactly
+    bool MessageHandleFixed (const CodedPacket &packet, int vehicle_id, int entries);
+    void OnlineAddFixed (std::vector<uint64_t> &function);//function: the coefficients followed by the integers, modulo the prime
+
+    int num_obser_expected;
+    std::vector<double> vehicle_beta;
+    int num_entries;
+    bool keep_batch;
+    std::vector<double> obser_list;
+    std::vector<std::vector<double>> obser_list_instance;
+    std::vector<std::vector<double> > coef;//all coefficients
+    std::vector<std::vector<double> > coef_instance;
+    std::vector<double> values_instance;
+    std::vector<std::vector<double> > coef_batch;
+    std::vector<double> rhs_batch;
+    std::vector<int> vehicle_id_can_calculate;
+    int online_num_values;//values per function, set by the first packet
+    std::vector<double> online_functions;//reduced functions, row after row
+    std::vector<int> online_pivot;//pivot vehicle of each reduced function
+    std::vector<int> online_recovered;//row holding the value of each vehicle, -1 if unknown
+    int online_num_recovered;
+    int online_value_bytes;//bytes per value of the field functions, 0 for real functions
+    std::vector<uint8_t> online_field_functions;//reduced field functions, row after row
+    std::vector<uint64_t> online_fixed_functions;//reduced functions of the FIXED packets, row after row
+    std::vector<int> online_scale;//scale of the quantized values of each vehicle in the FIXED packets, INT_MIN until known
+
+};
+
+#endif
@@ -0,0 +1,472 @@
+#include <cassert>
+#include "rui-crs-packet.h"
+
+namespace {
+
+/// Cursor over a byte array, with the calls of ns3::Buffer::Iterator that CodedPacket makes
+class ByteWriter
+{
+public:
+  ByteWriter (uint8_t *data)
+    : m_data (data)
+  {
+  }
+  void WriteU8 (uint8_t v)
+  {
+    *m_data++ = v;
+  }
+  void WriteHtolsbU32 (uint32_t v)
+  {
+    for (int k = 0; k < 4; k++)
+      {
+        *m_data++ = (v >> (8 * k)) & 0xff;
+      }
+  }
+  void WriteHtolsbU64 (uint64_t v)
+  {
+    for (int k = 0; k < 8; k++)
+      {
+        *m_data++ = (v >> (8 * k)) & 0xff;
+      }
+  }
+  void Write (const uint8_t *buffer, uint32_t size)
+  {
+    memcpy (m_data, buffer, size);
+    m_data += size;
+  }
+
+private:
+  uint8_t *m_data;
+};
+
+class ByteReader
+{
+public:
+  ByteReader (const uint8_t *data, uint32_t size)
+    : m_data (data),
+      m_end (data + size)
+  {
+  }
+  uint32_t GetRemainingSize (void) const
+  {
+    return m_end - m_data;
+  }
+  uint8_t ReadU8 (void)
+  {
+    return *m_data++;
+  }
+  uint32_t ReadLsbtohU32 (void)
+  {
+    uint32_t v = 0;
+    for (int k = 0; k < 4; k++)
+      {
+        v |= (uint32_t) *m_data++ << (8 * k);
+      }
+    return v;
+  }
+  uint64_t ReadLsbtohU64 (void)
+  {
+    uint64_t v = 0;
+    for (int k = 0; k < 8; k++)
+      {
+        v |= (uint64_t) *m_data++ << (8 * k);
+      }
+    return v;
+  }
+  void Read (uint8_t *buffer, uint32_t size)
+  {
+    memcpy (buffer, m_data, size);
+    m_data += size;
+  }
+
+private:
+  const uint8_t *m_data;
+  const uint8_t *m_end;
+};
+
+} // namespace
+
+//----------------------------------------------------------------------
+//-- CodedPacket
+//------------------------------------------------------
+
+CodedPacket::CodedPacket ()
+  : m_type (REGULAR),
+    m_flags (0),
+    m_scale (0),
+    m_valueBytes (8),
+    m_valid (true),
+    m_bitmap (),
+    m_values (),
+    m_symbols (),
+    m_integers (),
+    m_contributorScales ()
+{
+}
+
+uint32_t
+CodedPacket::GetSerializedSize (void) const
+{
+  if (HasValueBytes ())
+    {
+      uint32_t scales = HasContributorScales () ? GetNumContributors () : 0;
+      return FIXED_SIZE + FIXED_POINT_SIZE + m_bitmap.size () + scales + GetEntries () * m_valueBytes;
+    }
+  uint32_t value_size = IsFloat32 () ? 4 : 8;
+  return FIXED_SIZE + m_bitmap.size () + m_values.size () * value_size;
+}
+
+void
+CodedPacket::WriteBytes (uint8_t *data) const
+{
+  Write (ByteWriter (data));
+}
+
+uint32_t
+CodedPacket::ReadBytes (const uint8_t *data, uint32_t size)
+{
+  return Read (ByteReader (data, size));
+}
+
+void
+CodedPacket::Print (std::ostream &os) const
+{
+  // same shape as the legacy text payloads, e.g. IT|3+5|A|B|C
+  if (m_type == REGULAR)
+    {
+      os << "RP|Hello";
+      return;
+    }
+  if (IsInstance ())
+    {
+      os << "IT|";
+    }
+  std::vector<uint32_t> contributors = GetContributors ();
+  for (uint32_t k = 0; k < contributors.size (); k++)
+    {
+      os << (k == 0 ? "" : "+") << contributors[k];
+    }
+  std::vector<double> integer_values;
+  if (IsField ())
+    {
+      integer_values = GetFieldValues ();
+    }
+  else if (IsFixedPoint ())
+    {
+      integer_values = GetFixedValues ();
+    }
+  const std::vector<double> &values = (IsField () || IsFixedPoint ()) ? integer_values : m_values;
+  for (uint32_t k = 0; k < values.size (); k++)
+    {
+      os << ((k == 0 && contributors.empty ()) ? "" : "|") << values[k];
+    }
+}
+
+void
+CodedPacket::SetType (PacketType type)
+{
+  m_type = type;
+}
+
+CodedPacket::PacketType
+CodedPacket::GetType (void) const
+{
+  return (PacketType) m_type;
+}
+
+void
+CodedPacket::SetInstance (bool instance)
+{
+  m_flags = instance ? (m_flags | INSTANCE) : (m_flags & ~INSTANCE);
+}
+
+bool
+CodedPacket::IsInstance (void) const
+{
+  return m_flags & INSTANCE;
+}
+
+void
+CodedPacket::SetFloat32 (bool float32)
+{
+  m_flags = float32 ? (m_flags | FLOAT32) : (m_flags & ~FLOAT32);
+}
+
+bool
+CodedPacket::IsFloat32 (void) const
+{
+  return m_flags & FLOAT32;
+}
+
+void
+CodedPacket::SetFixedValues (int8_t scale, const std::vector<int64_t> &integers)
+{
+  // the fewest bytes whose two's complement holds every integer
+  uint8_t bytes = 1;
+  for (int64_t v : integers)
+    {
+      while (bytes < 8 && (v >> (8 * bytes - 1)) != (v < 0 ? -1 : 0))
+        {
+          bytes++;
+        }
+    }
+  m_flags = (m_flags | FIXED) & ~FIELD;
+  m_scale = scale;
+  m_valueBytes = bytes;
+  m_integers = integers;
+  m_values.clear ();
+  m_symbols.clear ();
+}
+
+bool
+CodedPacket::IsFixedPoint (void) const
+{
+  return m_flags & FIXED;
+}
+
+const std::vector<int64_t> &
+CodedPacket::GetIntegers (void) const
+{
+  return m_integers;
+}
+
+std::vector<double>
+CodedPacket::GetFixedValues (void) const
+{
+  std::vector<double> values (m_integers.size ());
+  for (size_t k = 0; k < values.size (); k++)
+    {
+      values[k] = std::ldexp ((double) m_integers[k], m_scale);
+    }
+  return values;
+}
+
+bool
+CodedPacket::SetContributorScale (uint32_t index, int8_t scale)
+{
+  if (index >= GetBitmapBits ())
+    {
+      CRS_LOG_DEBUG ("Vehicle index " << index << " outside the contributor bitmap of " << m_bitmap.size () << " bytes");
+      return false;
+    }
+  if (m_contributorScales.size () < GetBitmapBits ())
+    {
+      m_contributorScales.resize (GetBitmapBits (), 0);
+    }
+  m_contributorScales[index] = scale;
+  return true;
+}
+
+int8_t
+CodedPacket::GetContributorScale (uint32_t index) const
+{
+  return index < m_contributorScales.size () ? m_contributorScales[index] : 0;
+}
+
+int8_t
+CodedPacket::GetScale (void) const
+{
+  return m_scale;
+}
+
+uint8_t
+CodedPacket::GetValueBytes (void) const
+{
+  return m_valueBytes;
+}
+
+bool
+CodedPacket::SetFieldValues (const std::vector<double> &values, int8_t scale, uint8_t bytes)
+{
+  assert (bytes >= 1 && bytes <= 8 && "Field values of 1 to 8 bytes");
+  std::vector<uint8_t> symbols (values.size () * bytes);
+  for (size_t k = 0; k < values.size (); k++)
+    {
+      if (!IntegerToSymbols (values[k], bytes, &symbols[k * bytes]))
+        {
+          CRS_LOG_DEBUG ("Field value " << values[k] << " not an integer of " << (uint32_t) bytes << " bytes");
+          return false;
+        }
+    }
+  m_flags = (m_flags | FIELD) & ~FIXED;
+  m_scale = scale;
+  m_valueBytes = bytes;
+  m_symbols.swap (symbols);
+  m_values.clear ();
+  m_integers.clear ();
+  return true;
+}
+
+bool
+CodedPacket::IsField (void) const
+{
+  return m_flags & FIELD;
+}
+
+std::vector<double>
+CodedPacket::GetFieldValues (void) const
+{
+  std::vector<double> values (GetEntries ());
+  for (size_t k = 0; k < values.size (); k++)
+    {
+      values[k] = SymbolsToInteger (&m_symbols[k * m_valueBytes], m_valueBytes);
+    }
+  return values;
+}
+
+std::vector<uint8_t> &
+CodedPacket::GetSymbols (void)
+{
+  return m_symbols;
+}
+
+const std::vector<uint8_t> &
+CodedPacket::GetSymbols (void) const
+{
+  return m_symbols;
+}
+
+bool
+CodedPacket::IntegerToSymbols (double value, uint8_t bytes, uint8_t *symbols)
+{
+  // beyond 2^53 a double is no longer a reliable integer, and llround of it may overflow
+  if (!(std::fabs (value) < 9007199254740992.0) || std::trunc (value) != value)
+    {
+      return false;
+    }
+  int64_t fixed = (int64_t) value;
+  if (bytes < 8 && (fixed >> (8 * bytes - 1)) != (fixed < 0 ? -1 : 0))
+    {
+      return false;
+    }
+  Int64ToSymbols (fixed, bytes, symbols);
+  return true;
+}
+
+double
+CodedPacket::SymbolsToInteger (const uint8_t *symbols, uint8_t bytes)
+{
+  return (double) SymbolsToInt64 (symbols, bytes);
+}
+
+int64_t
+CodedPacket::SymbolsToInt64 (const uint8_t *symbols, uint8_t bytes)
+{
+  uint64_t bits = 0;
+  for (uint8_t k = 0; k < bytes; k++)
+    {
+      bits |= (uint64_t) symbols[k] << (8 * k);
+    }
+  int shift = 64 - 8 * bytes;
+  return (int64_t) (bits << shift) >> shift; //sign extension
+}
+
+void
+CodedPacket::Int64ToSymbols (int64_t value, uint8_t bytes, uint8_t *symbols)
+{
+  uint64_t bits = value;
+  for (uint8_t k = 0; k < bytes; k++)
+    {
+      symbols[k] = (bits >> (8 * k)) & 0xff;
+    }
+}
+
+uint32_t
+CodedPacket::GetEntries (void) const
+{
+  if (IsField ())
+    {
+      return m_symbols.size () / m_valueBytes;
+    }
+  return IsFixedPoint () ? m_integers.size () : m_values.size ();
+}
+
+uint32_t
+CodedPacket::GetNumContributors (void) const
+{
+  uint32_t count = 0;
+  for (uint8_t byte : m_bitmap)
+    {
+      count += __builtin_popcount (byte);
+    }
+  return count;
+}
+
+bool
+CodedPacket::IsValid (void) const
+{
+  return m_valid;
+}
+
+bool
+CodedPacket::SetGroupSize (uint32_t group_size)
+{
+  if (group_size > MAX_GROUP_SIZE)
+    {
+      CRS_LOG_DEBUG ("Cluster of " << group_size << " vehicles too large for the contributor bitmap");
+      return false;
+    }
+  m_bitmap.assign ((group_size + 7) / 8, 0);
+  return true;
+}
+
+bool
+CodedPacket::AddContributor (uint32_t index)
+{
+  if (index / 8 >= m_bitmap.size ())
+    {
+      CRS_LOG_DEBUG ("Vehicle index " << index << " outside the contributor bitmap of " << m_bitmap.size () << " bytes");
+      return false;
+    }
+  m_bitmap[index / 8] |= (1 << (index % 8));
+  return true;
+}
+
+bool
+CodedPacket::FitsGroup (uint32_t group_size) const
+{
+  if (m_bitmap.size () != (group_size + 7) / 8)
+    {
+      return false;
+    }
+  // the bits past group_size in the last byte
+  return group_size % 8 == 0 || (m_bitmap.back () >> (group_size % 8)) == 0;
+}
+
+bool
+CodedPacket::HasContributor (uint32_t index) const
+{
+  return index / 8 < m_bitmap.size () && (m_bitmap[index / 8] & (1 << (index % 8)));
+}
+
+std::vector<uint32_t>
+CodedPacket::GetContributors (void) const
+{
+  std::vector<uint32_t> contributors;
+  for (uint32_t index = 0; index < m_bitmap.size () * 8; index++)
+    {
+      if (HasContributor (index))
+        {
+          contributors.push_back (index);
+        }
+    }
+  return contributors;
+}
+
+void
+CodedPacket::SetValues (const std::vector<double> &values)
+{
+  m_values = values;
+}
+
+std::vector<double> &
+CodedPacket::GetValues (void)
+{
+  return m_values;
+}
+
+const std::vector<double> &
+CodedPacket::GetValues (void) const
+{
+  return m_values;
+}
@@ -0,0 +1,340 @@
+#ifndef RUI_CRS_PACKET_H
+#define RUI_CRS_PACKET_H
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Rui: debug messages of the coding core, to std::clog when built with -DCRS_CORE_DEBUG
+#ifdef CRS_CORE_DEBUG
+#define CRS_LOG_DEBUG(msg) (std::clog << msg << std::endl)
+#else
+#define CRS_LOG_DEBUG(msg)
+#endif
+
+/**
+ * \brief Content of a CRS packet, without ns-3.
+ *
+ * Wire layout, all fields little-endian:
+ *
+ *   version (8) | type (8) | flags (8) | bitmap bytes (8) | entries (32)
+ *   [scale (8, signed) | value bytes (8)]   only when FIXED or FIELD is set
+ *   contributor bitmap (bitmap bytes, bit i = vehicle index i in the cluster)
+ *   [scale of each contributor (8, signed), in index order]   only in a
+ *   CODED packet with FIXED set
+ *   entries values (float64, float32 when FLOAT32 is set, or signed
+ *   integers of value bytes bytes when FIXED or FIELD is set)
+ *
+ * A FIXED packet carries quantized values (Quantize in rui-crs-core.h): an
+ * integer v stands for v * 2^scale. The sender quantizes its values to 8 or
+ * 16 bits with a scale of its own; the relays add the integer betas times
+ * their own quantized values in int64 (RelayEncodeQuantized), in units of the
+ * smallest scale of the contributors, and note the scale of each contributor
+ * so the head can decode the integers exactly. The value bytes are the fewest
+ * that hold the largest integer, so they grow with the coded sums.
+ *
+ * In a FIELD packet the bytes of the integers are symbols of GF(2^8)
+ * (rui-gf256.h), which relays code byte by byte, so the values stay as
+ * bytes in memory (GetSymbols) and a coded packet is as large as an
+ * original one.
+ *
+ * The bitmap has a fixed size for a given cluster, so relays can add their
+ * contribution without changing the packet size, except to FIXED packets. Write and Read take any
+ * cursor with the interface of ns3::Buffer::Iterator; CodedPacketHeader
+ * passes its buffer, WriteBytes and ReadBytes a byte array.
+ */
+class CodedPacket
+{
+public:
+  enum PacketType
+  {
+    REGULAR = 0,  //!< warm-up packet, no values ("RP|Hello")
+    ORIGINAL = 1, //!< sent by a member, not yet encoded by any relay
+    CODED = 2     //!< encoded by at least one relay
+  };
+
+  enum Flags
+  {
+    INSTANCE = 0x01, //!< the values are the entries of an instance (large w_i)
+    FLOAT32 = 0x02,  //!< the values travel as float32 instead of float64
+    FIXED = 0x04,    //!< the values travel as quantized integers, see SetFixedValues
+    FIELD = 0x08     //!< the values travel as symbols of GF(2^8), see SetFieldValues
+  };
+
+  static const uint8_t VERSION = 1;
+  static const uint32_t FIXED_SIZE = 8;
+  static const uint32_t FIXED_POINT_SIZE = 2; //!< scale and value bytes of a FIXED or FIELD packet
+  static const uint32_t MAX_GROUP_SIZE = 255 * 8; //!< vehicles of the largest bitmap
+
+  CodedPacket ();
+
+  uint32_t GetSerializedSize (void) const;
+  template <class Writer>
+  void Write (Writer i) const;
+  /// \return the bytes read, see IsValid
+  template <class Reader>
+  uint32_t Read (Reader i);
+  /// Write to data, which holds GetSerializedSize () bytes
+  void WriteBytes (uint8_t *data) const;
+  /// Read from the size bytes of data, \return the bytes read
+  uint32_t ReadBytes (const uint8_t *data, uint32_t size);
+  void Print (std::ostream &os) const;
+
+  void SetType (PacketType type);
+  PacketType GetType (void) const;
+  void SetInstance (bool instance);
+  bool IsInstance (void) const;
+  void SetFloat32 (bool float32);
+  bool IsFloat32 (void) const;
+  /// Carry integers[k] * 2^scale as the values, e.g. those of Quantize (rui-crs-core.h), in
+  /// place of float32/float64. The value bytes are the fewest that hold the largest |integer|.
+  void SetFixedValues (int8_t scale, const std::vector<int64_t> &integers);
+  bool IsFixedPoint (void) const;
+  const std::vector<int64_t> &GetIntegers (void) const;
+  /// integers[k] * 2^scale, e.g. the quantized values of an original FIXED packet
+  std::vector<double> GetFixedValues (void) const;
+  /// The scale of the quantized values of contributor index of a CODED FIXED packet;
+  /// false if index is outside the bitmap
+  bool SetContributorScale (uint32_t index, int8_t scale);
+  int8_t GetContributorScale (uint32_t index) const;
+  int8_t GetScale (void) const;
+  uint8_t GetValueBytes (void) const;
+  /// Carry the integer values as bytes bytes each (two's complement, little-endian), coded
+  /// over GF(2^8) by the relays. Replaces the values, see GetFieldValues. Returns false,
+  /// leaving the packet as it was, if a value is not an integer that fits.
+  bool SetFieldValues (const std::vector<double> &values, int8_t scale, uint8_t bytes);
+  bool IsField (void) const;
+  /// The integers of the symbols, e.g. of an original FIELD packet
+  std::vector<double> GetFieldValues (void) const;
+  std::vector<uint8_t> &GetSymbols (void);
+  const std::vector<uint8_t> &GetSymbols (void) const;
+  /// value as bytes two's complement bytes, little-endian; false, writing nothing, if value
+  /// is not an integer or does not fit (|value| < 2^(8 bytes - 1), and 2^53 for 8 bytes)
+  static bool IntegerToSymbols (double value, uint8_t bytes, uint8_t *symbols);
+  /// The integer of bytes symbols, sign-extended
+  static double SymbolsToInteger (const uint8_t *symbols, uint8_t bytes);
+  static int64_t SymbolsToInt64 (const uint8_t *symbols, uint8_t bytes);
+  /// The bytes bytes of value, two's complement, little-endian; value must fit them
+  static void Int64ToSymbols (int64_t value, uint8_t bytes, uint8_t *symbols);
+  /// false if the last Read met an unknown version or a truncated buffer
+  bool IsValid (void) const;
+
+  /// Size the contributor bitmap for a cluster of group_size vehicles; false, leaving
+  /// the bitmap as it was, if the cluster has more than MAX_GROUP_SIZE vehicles
+  bool SetGroupSize (uint32_t group_size);
+  /// false if index is outside the bitmap, e.g. of a shorter bitmap read from the wire
+  bool AddContributor (uint32_t index);
+  /// true if the bitmap is that of a cluster of group_size vehicles and only has
+  /// contributors of the cluster, so the receiver can index its vehicles by them
+  bool FitsGroup (uint32_t group_size) const;
+  /// vehicle indexes the bitmap can hold, 8 per byte
+  uint32_t GetBitmapBits (void) const
+  {
+    return m_bitmap.size () * 8;
+  }
+  bool HasContributor (uint32_t index) const;
+  std::vector<uint32_t> GetContributors (void) const;
+
+  void SetValues (const std::vector<double> &values);
+  std::vector<double> &GetValues (void);
+  const std::vector<double> &GetValues (void) const;
+
+private:
+  /// true if the scale and value bytes are on the wire
+  bool HasValueBytes (void) const
+  {
+    return m_flags & (FIXED | FIELD);
+  }
+  /// true if the scales of the contributors are on the wire
+  bool HasContributorScales (void) const
+  {
+    return (m_flags & FIXED) && m_type == CODED;
+  }
+  uint32_t GetEntries (void) const;
+  uint32_t GetNumContributors (void) const;
+
+  uint8_t m_type;
+  uint8_t m_flags;
+  int8_t m_scale;
+  uint8_t m_valueBytes;
+  bool m_valid;
+  std::vector<uint8_t> m_bitmap;
+  std::vector<double> m_values;
+  std::vector<uint8_t> m_symbols; //!< values of a FIELD packet, value bytes per value
+  std::vector<int64_t> m_integers; //!< values of a FIXED packet
+  std::vector<int8_t> m_contributorScales; //!< scale of each vehicle of a CODED FIXED packet, by index
+};
+
+template <class Writer>
+void
+CodedPacket::Write (Writer i) const
+{
+  i.WriteU8 (VERSION);
+  i.WriteU8 (m_type);
+  i.WriteU8 (m_flags);
+  i.WriteU8 (m_bitmap.size ());
+  i.WriteHtolsbU32 (GetEntries ());
+  if (HasValueBytes ())
+    {
+      i.WriteU8 ((uint8_t) m_scale);
+      i.WriteU8 (m_valueBytes);
+    }
+  if (!m_bitmap.empty ())
+    {
+      i.Write (m_bitmap.data (), m_bitmap.size ());
+    }
+  if (HasContributorScales ())
+    {
+      for (uint32_t index = 0; index < GetBitmapBits (); index++)
+        {
+          if (HasContributor (index))
+            {
+              i.WriteU8 ((uint8_t) GetContributorScale (index));
+            }
+        }
+    }
+  if (IsField ())
+    {
+      if (!m_symbols.empty ())
+        {
+          i.Write (m_symbols.data (), m_symbols.size ());
+        }
+    }
+  else if (IsFixedPoint ())
+    {
+      uint8_t symbols[8];
+      for (int64_t v : m_integers)
+        {
+          Int64ToSymbols (v, m_valueBytes, symbols);
+          i.Write (symbols, m_valueBytes);
+        }
+    }
+  else if (IsFloat32 ())
+    {
+      for (double v : m_values)
+        {
+          float f = v;
+          uint32_t bits;
+          memcpy (&bits, &f, 4);
+          i.WriteHtolsbU32 (bits);
+        }
+    }
+  else
+    {
+      for (double v : m_values)
+        {
+          uint64_t bits;
+          memcpy (&bits, &v, 8);
+          i.WriteHtolsbU64 (bits);
+        }
+    }
+}
+
+template <class Reader>
+uint32_t
+CodedPacket::Read (Reader i)
+{
+  m_valid = false;
+  m_bitmap.clear ();
+  m_values.clear ();
+  m_symbols.clear ();
+  m_integers.clear ();
+  m_contributorScales.clear ();
+  if (i.GetRemainingSize () < FIXED_SIZE)
+    {
+      CRS_LOG_DEBUG ("Truncated coded packet header");
+      return 0;
+    }
+
+  uint8_t version = i.ReadU8 ();
+  m_type = i.ReadU8 ();
+  m_flags = i.ReadU8 ();
+  uint8_t bitmap_bytes = i.ReadU8 ();
+  uint32_t entries = i.ReadLsbtohU32 ();
+  if (HasValueBytes ())
+    {
+      if (i.GetRemainingSize () < FIXED_POINT_SIZE)
+        {
+          CRS_LOG_DEBUG ("Truncated fixed-point header");
+          return FIXED_SIZE;
+        }
+      m_scale = (int8_t) i.ReadU8 ();
+      m_valueBytes = i.ReadU8 ();
+    }
+  uint32_t value_size = HasValueBytes () ? m_valueBytes : (IsFloat32 () ? 4 : 8);
+  if (version != VERSION || (HasValueBytes () && (m_valueBytes < 1 || m_valueBytes > 8))
+      || i.GetRemainingSize () < bitmap_bytes + (uint64_t) entries * value_size)
+    {
+      CRS_LOG_DEBUG ("Unknown version " << (uint32_t) version << " or truncated payload");
+      return FIXED_SIZE;
+    }
+
+  m_bitmap.resize (bitmap_bytes);
+  if (bitmap_bytes > 0)
+    {
+      i.Read (m_bitmap.data (), bitmap_bytes);
+    }
+  if (HasContributorScales ())
+    {
+      if (i.GetRemainingSize () < GetNumContributors () + (uint64_t) entries * value_size)
+        {
+          CRS_LOG_DEBUG ("Truncated contributor scales");
+          return FIXED_SIZE;
+        }
+      m_contributorScales.assign (GetBitmapBits (), 0);
+      for (uint32_t index = 0; index < GetBitmapBits (); index++)
+        {
+          if (HasContributor (index))
+            {
+              m_contributorScales[index] = (int8_t) i.ReadU8 ();
+            }
+        }
+    }
+  if (IsField ())
+    {
+      m_symbols.resize ((size_t) entries * m_valueBytes);
+      if (!m_symbols.empty ())
+        {
+          i.Read (m_symbols.data (), m_symbols.size ());
+        }
+      m_valid = true;
+      return GetSerializedSize ();
+    }
+  if (IsFixedPoint ())
+    {
+      m_integers.resize (entries);
+      uint8_t symbols[8];
+      for (uint32_t k = 0; k < entries; k++)
+        {
+          i.Read (symbols, m_valueBytes);
+          m_integers[k] = SymbolsToInt64 (symbols, m_valueBytes);
+        }
+      m_valid = true;
+      return GetSerializedSize ();
+    }
+  m_values.resize (entries);
+  if (IsFloat32 ())
+    {
+      for (uint32_t k = 0; k < entries; k++)
+        {
+          uint32_t bits = i.ReadLsbtohU32 ();
+          float f;
+          memcpy (&f, &bits, 4);
+          m_values[k] = f;
+        }
+    }
+  else
+    {
+      for (uint32_t k = 0; k < entries; k++)
+        {
+          uint64_t bits = i.ReadLsbtohU64 ();
+          memcpy (&m_values[k], &bits, 8);
+        }
+    }
+  m_valid = true;
+  return GetSerializedSize ();
+}
+
+#endif
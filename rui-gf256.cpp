@@ -0,0 +1,303 @@
+#include <cstring>
+#include "rui-gf256.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RUI_GF256_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/// Below this many bytes, multiply through the log tables instead of building the nibble tables
+const std::size_t SHORT_SIZE = 32;
+
+typedef void (*MulAddFunction) (uint8_t *y, const uint8_t *x, uint8_t c, std::size_t n);
+typedef void (*ScaleFunction) (uint8_t *y, uint8_t c, std::size_t n);
+
+/// Logarithms and powers of the generator 3, exp doubled so that exp[log a + log b] needs no modulo
+struct Tables
+{
+  uint8_t exp[510];
+  uint8_t log[256];
+
+  Tables ()
+  {
+    uint8_t x = 1;
+    for (int i = 0; i < 255; i++)
+      {
+        exp[i] = x;
+        exp[i + 255] = x;
+        log[x] = i;
+        // x * 3 = x * 2 + x, reduced by the polynomial 0x11b
+        x = x ^ (uint8_t) ((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+      }
+    log[0] = 0;
+  }
+};
+
+const Tables &
+GetTables (void)
+{
+  static const Tables tables;
+  return tables;
+}
+
+/// c times each nibble: low[i] = c * i, high[i] = c * (i << 4)
+void
+NibbleTables (uint8_t c, uint8_t low[16], uint8_t high[16])
+{
+  for (int i = 0; i < 16; i++)
+    {
+      low[i] = GfMul (c, i);
+      high[i] = GfMul (c, i << 4);
+    }
+}
+
+void
+MulAddScalar (uint8_t *y, const uint8_t *x, uint8_t c, std::size_t n)
+{
+  uint8_t low[16], high[16];
+  NibbleTables (c, low, high);
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] ^= low[x[i] & 0x0f] ^ high[x[i] >> 4];
+    }
+}
+
+void
+ScaleScalar (uint8_t *y, uint8_t c, std::size_t n)
+{
+  uint8_t low[16], high[16];
+  NibbleTables (c, low, high);
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] = low[y[i] & 0x0f] ^ high[y[i] >> 4];
+    }
+}
+
+#ifdef RUI_GF256_X86
+__attribute__ ((target ("avx2"))) inline __m256i
+MulAvx2 (__m256i x, __m256i low, __m256i high, __m256i nibble)
+{
+  __m256i lo = _mm256_shuffle_epi8 (low, _mm256_and_si256 (x, nibble));
+  __m256i hi = _mm256_shuffle_epi8 (high, _mm256_and_si256 (_mm256_srli_epi64 (x, 4), nibble));
+  return _mm256_xor_si256 (lo, hi);
+}
+
+__attribute__ ((target ("avx2"))) void
+MulAddAvx2 (uint8_t *y, const uint8_t *x, uint8_t c, std::size_t n)
+{
+  uint8_t lowTable[16], highTable[16];
+  NibbleTables (c, lowTable, highTable);
+  const __m256i low = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) lowTable));
+  const __m256i high = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) highTable));
+  const __m256i nibble = _mm256_set1_epi8 (0x0f);
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32)
+    {
+      __m256i vx = _mm256_loadu_si256 ((const __m256i *) (x + i));
+      __m256i vy = _mm256_loadu_si256 ((const __m256i *) (y + i));
+      _mm256_storeu_si256 ((__m256i *) (y + i), _mm256_xor_si256 (vy, MulAvx2 (vx, low, high, nibble)));
+    }
+  for (; i < n; i++)
+    {
+      y[i] ^= lowTable[x[i] & 0x0f] ^ highTable[x[i] >> 4];
+    }
+}
+
+__attribute__ ((target ("avx2"))) void
+ScaleAvx2 (uint8_t *y, uint8_t c, std::size_t n)
+{
+  uint8_t lowTable[16], highTable[16];
+  NibbleTables (c, lowTable, highTable);
+  const __m256i low = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) lowTable));
+  const __m256i high = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) highTable));
+  const __m256i nibble = _mm256_set1_epi8 (0x0f);
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32)
+    {
+      __m256i vy = _mm256_loadu_si256 ((const __m256i *) (y + i));
+      _mm256_storeu_si256 ((__m256i *) (y + i), MulAvx2 (vy, low, high, nibble));
+    }
+  for (; i < n; i++)
+    {
+      y[i] = lowTable[y[i] & 0x0f] ^ highTable[y[i] >> 4];
+    }
+}
+
+__attribute__ ((target ("avx512f,avx512bw"))) inline __m512i
+MulAvx512 (__m512i x, __m512i low, __m512i high, __m512i nibble)
+{
+  __m512i lo = _mm512_shuffle_epi8 (low, _mm512_and_si512 (x, nibble));
+  __m512i hi = _mm512_shuffle_epi8 (high, _mm512_and_si512 (_mm512_maskz_srli_epi64 (0xff, x, 4), nibble));
+  return _mm512_xor_si512 (lo, hi);
+}
+
+__attribute__ ((target ("avx512f,avx512bw"))) void
+MulAddAvx512 (uint8_t *y, const uint8_t *x, uint8_t c, std::size_t n)
+{
+  uint8_t lowTable[16], highTable[16];
+  NibbleTables (c, lowTable, highTable);
+  const __m512i low = _mm512_maskz_broadcast_i32x4 (0xffff, _mm_loadu_si128 ((const __m128i *) lowTable));
+  const __m512i high = _mm512_maskz_broadcast_i32x4 (0xffff, _mm_loadu_si128 ((const __m128i *) highTable));
+  const __m512i nibble = _mm512_set1_epi8 (0x0f);
+  std::size_t i = 0;
+  for (; i + 64 <= n; i += 64)
+    {
+      __m512i vx = _mm512_loadu_si512 ((const void *) (x + i));
+      __m512i vy = _mm512_loadu_si512 ((const void *) (y + i));
+      _mm512_storeu_si512 ((void *) (y + i), _mm512_xor_si512 (vy, MulAvx512 (vx, low, high, nibble)));
+    }
+  if (i < n)
+    {
+      // masked tail, n - i < 64 bytes left
+      __mmask64 m = (~0ULL) >> (64 - (n - i));
+      __m512i vx = _mm512_maskz_loadu_epi8 (m, x + i);
+      __m512i vy = _mm512_maskz_loadu_epi8 (m, y + i);
+      _mm512_mask_storeu_epi8 (y + i, m, _mm512_xor_si512 (vy, MulAvx512 (vx, low, high, nibble)));
+    }
+}
+
+__attribute__ ((target ("avx512f,avx512bw"))) void
+ScaleAvx512 (uint8_t *y, uint8_t c, std::size_t n)
+{
+  uint8_t lowTable[16], highTable[16];
+  NibbleTables (c, lowTable, highTable);
+  const __m512i low = _mm512_maskz_broadcast_i32x4 (0xffff, _mm_loadu_si128 ((const __m128i *) lowTable));
+  const __m512i high = _mm512_maskz_broadcast_i32x4 (0xffff, _mm_loadu_si128 ((const __m128i *) highTable));
+  const __m512i nibble = _mm512_set1_epi8 (0x0f);
+  std::size_t i = 0;
+  for (; i + 64 <= n; i += 64)
+    {
+      __m512i vy = _mm512_loadu_si512 ((const void *) (y + i));
+      _mm512_storeu_si512 ((void *) (y + i), MulAvx512 (vy, low, high, nibble));
+    }
+  if (i < n)
+    {
+      __mmask64 m = (~0ULL) >> (64 - (n - i));
+      __m512i vy = _mm512_maskz_loadu_epi8 (m, y + i);
+      _mm512_mask_storeu_epi8 (y + i, m, MulAvx512 (vy, low, high, nibble));
+    }
+}
+#endif
+
+struct GfKernel
+{
+  MulAddFunction muladd;
+  ScaleFunction scale;
+  const char *name;
+};
+
+/// The implementation called name if the CPU has it, the best one if name is 0
+bool
+SelectKernel (const char *name, GfKernel &kernel)
+{
+#ifdef RUI_GF256_X86
+  __builtin_cpu_init ();
+  if ((name == 0 || strcmp (name, "avx512") == 0) && __builtin_cpu_supports ("avx512f")
+      && __builtin_cpu_supports ("avx512bw"))
+    {
+      kernel = GfKernel {&MulAddAvx512, &ScaleAvx512, "avx512"};
+      return true;
+    }
+  if ((name == 0 || strcmp (name, "avx2") == 0) && __builtin_cpu_supports ("avx2"))
+    {
+      kernel = GfKernel {&MulAddAvx2, &ScaleAvx2, "avx2"};
+      return true;
+    }
+#endif
+  if (name == 0 || strcmp (name, "scalar") == 0)
+    {
+      kernel = GfKernel {&MulAddScalar, &ScaleScalar, "scalar"};
+      return true;
+    }
+  return false;
+}
+
+GfKernel &
+GetKernel (void)
+{
+  static GfKernel kernel = [] () {
+    GfKernel best;
+    SelectKernel (0, best);
+    return best;
+  } ();
+  return kernel;
+}
+
+} // namespace
+
+uint8_t
+GfMul (uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0)
+    {
+      return 0;
+    }
+  const Tables &t = GetTables ();
+  return t.exp[t.log[a] + t.log[b]];
+}
+
+uint8_t
+GfInv (uint8_t a)
+{
+  const Tables &t = GetTables ();
+  return t.exp[255 - t.log[a]];
+}
+
+uint8_t
+GfCoefficient (int source_index, int index)
+{
+  // a hash of the pair (the finalizer of MurmurHash3), mapped onto 1..255
+  uint32_t h = (uint32_t) source_index * 0x9e3779b1u ^ (uint32_t) index * 0x85ebca77u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return 1 + h % 255;
+}
+
+void
+GfMulAdd (uint8_t *y, const uint8_t *x, uint8_t c, std::size_t n)
+{
+  if (c == 0)
+    {
+      return;
+    }
+  if (n < SHORT_SIZE)
+    {
+      for (std::size_t i = 0; i < n; i++)
+        {
+          y[i] ^= GfMul (c, x[i]);
+        }
+      return;
+    }
+  GetKernel ().muladd (y, x, c, n);
+}
+
+void
+GfScale (uint8_t *y, uint8_t c, std::size_t n)
+{
+  if (n < SHORT_SIZE)
+    {
+      for (std::size_t i = 0; i < n; i++)
+        {
+          y[i] = GfMul (c, y[i]);
+        }
+      return;
+    }
+  GetKernel ().scale (y, c, n);
+}
+
+bool
+GfUseKernel (const char *name)
+{
+  return SelectKernel (name, GetKernel ());
+}
+
+const char *
+GfKernelName (void)
+{
+  return GetKernel ().name;
+}
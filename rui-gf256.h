@@ -0,0 +1,35 @@
+#ifndef RUI_GF256_H
+#define RUI_GF256_H
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Rui: arithmetic in GF(2^8), for network coding over a finite field
+ * (--gfCoding). The field is that of AES, polynomial x^8 + x^4 + x^3 + x + 1.
+ * Addition is XOR, so the coded sums never grow and the decoding is exact.
+ * The vector kernels multiply 32 (AVX2) or 64 (AVX-512BW) bytes at a time
+ * by looking up the low and high nibbles of each byte in two 16-byte tables
+ * (pshufb), picked once at run time.
+ */
+
+uint8_t GfMul (uint8_t a, uint8_t b);
+/// Inverse of a non-zero a
+uint8_t GfInv (uint8_t a);
+
+/// Coefficient of the vehicle at index in the packet sent by the vehicle at source_index: a
+/// non-zero hash of the pair, which the head recomputes from the source of the packet. A
+/// coefficient fixed per vehicle would make the packets of a cycle of routes dependent.
+uint8_t GfCoefficient (int source_index, int index);
+
+/// y[i] = y[i] + c * x[i], e.g. a router adding its coded symbols to a packet
+void GfMulAdd (uint8_t *y, const uint8_t *x, uint8_t c, std::size_t n);
+/// y[i] = c * y[i]
+void GfScale (uint8_t *y, uint8_t c, std::size_t n);
+
+/// Name of the selected implementation: "avx512", "avx2" or "scalar"
+const char *GfKernelName (void);
+/// Use the implementation called name instead, e.g. to check it against "scalar"
+/// (0 for the best one again); false, keeping the current one, if the CPU does not have it
+bool GfUseKernel (const char *name);
+
+#endif
@@ -0,0 +1,597 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/simulator.h"
+#include "ns3/node-list.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "rui-mobility-trace.h"
+#include "rui-crs-core.h"
+#include "rui-spatial-cluster.h"
+
+NS_LOG_COMPONENT_DEFINE ("rui-mobility-trace");
+
+namespace {
+
+const char MAGIC[8] = {'C', 'R', 'S', 'M', 'O', 'B', '1', '\0'};
+
+struct MobilityTraceHeader
+{
+  char magic[8];
+  uint32_t nodes;
+  uint32_t reserved;
+  uint64_t waypoints;
+};
+
+static_assert (sizeof (MobilityTraceHeader) == 24, "binary trace header layout");
+static_assert (sizeof (MobilityWaypoint) == 48, "binary trace waypoint layout");
+
+/// Node ID of a "$node_(ID)" token
+bool
+ParseNode (std::string_view token, int &node)
+{
+  const std::string_view prefix = "$node_(";
+  if (token.size () <= prefix.size () + 1 || token.substr (0, prefix.size ()) != prefix || token.back () != ')')
+    {
+      return false;
+    }
+  return ParseNumber (token.substr (prefix.size (), token.size () - prefix.size () - 1), node) && node >= 0;
+}
+
+/// Set one coordinate ("X_", "Y_" or "Z_") of a SET_POSITION waypoint
+bool
+SetAxis (MobilityWaypoint &waypoint, std::string_view axis, double value)
+{
+  if (axis == "X_")
+    {
+      waypoint.x = value;
+    }
+  else if (axis == "Y_")
+    {
+      waypoint.y = value;
+    }
+  else if (axis == "Z_")
+    {
+      waypoint.z = value;
+    }
+  else
+    {
+      return false;
+    }
+  return true;
+}
+
+struct TraceCursor
+{
+  std::shared_ptr<const MobilityTraceFile> file; //!< keeps the mapping alive
+  ns3::Ptr<ns3::ConstantVelocityMobilityModel> model;
+  const MobilityWaypoint *next;
+  const MobilityWaypoint *end;
+  ns3::EventId stop;
+};
+
+void
+Apply (TraceCursor &cursor, const MobilityWaypoint &waypoint)
+{
+  ns3::Vector position = cursor.model->GetPosition ();
+  if (waypoint.type == MobilityWaypoint::SET_POSITION)
+    {
+      position.x = std::isnan (waypoint.x) ? position.x : waypoint.x;
+      position.y = std::isnan (waypoint.y) ? position.y : waypoint.y;
+      position.z = std::isnan (waypoint.z) ? position.z : waypoint.z;
+      cursor.model->SetPosition (position);
+      return;
+    }
+
+  // same movement as Ns2MobilityHelper: straight to the destination, stop on arrival
+  cursor.stop.Cancel ();
+  double dx = waypoint.x - position.x;
+  double dy = waypoint.y - position.y;
+  double distance = std::sqrt (dx * dx + dy * dy);
+  if (waypoint.speed <= 0 || distance == 0)
+    {
+      cursor.model->SetVelocity (ns3::Vector (0, 0, 0));
+      return;
+    }
+  cursor.model->SetVelocity (ns3::Vector (dx / distance * waypoint.speed, dy / distance * waypoint.speed, 0));
+  cursor.stop = ns3::Simulator::Schedule (ns3::Seconds (distance / waypoint.speed),
+                                          &ns3::ConstantVelocityMobilityModel::SetVelocity,
+                                          cursor.model, ns3::Vector (0, 0, 0));
+}
+
+/// Apply the waypoints reached by now, then schedule the next one
+void
+Advance (std::shared_ptr<TraceCursor> cursor)
+{
+  ns3::Time now = ns3::Simulator::Now ();
+  while (cursor->next != cursor->end && ns3::Seconds (cursor->next->time) <= now)
+    {
+      Apply (*cursor, *cursor->next);
+      cursor->next++;
+    }
+  if (cursor->next != cursor->end)
+    {
+      ns3::Simulator::Schedule (ns3::Seconds (cursor->next->time) - now, &Advance, cursor);
+    }
+}
+
+void
+InstallOn (const std::shared_ptr<const MobilityTraceFile> &file, ns3::Ptr<ns3::Node> node)
+{
+  uint64_t count = 0;
+  const MobilityWaypoint *waypoints = file->GetWaypoints (node->GetId (), count);
+  if (count == 0)
+    {
+      return;
+    }
+  ns3::Ptr<ns3::MobilityModel> object = node->GetObject<ns3::MobilityModel> ();
+  ns3::Ptr<ns3::ConstantVelocityMobilityModel> model;
+  if (object == 0)
+    {
+      model = ns3::CreateObject<ns3::ConstantVelocityMobilityModel> ();
+      node->AggregateObject (model);
+    }
+  else
+    {
+      model = ns3::DynamicCast<ns3::ConstantVelocityMobilityModel> (object);
+      if (model == 0)
+        {
+          NS_FATAL_ERROR ("Node " << node->GetId () << " already has a mobility model other than ConstantVelocityMobilityModel");
+        }
+    }
+  std::shared_ptr<TraceCursor> cursor = std::make_shared<TraceCursor> ();
+  cursor->file = file;
+  cursor->model = model;
+  cursor->next = waypoints;
+  cursor->end = waypoints + count;
+  Advance (cursor);
+}
+
+/// Position of a vehicle along its waypoints, for times that only increase
+class Trajectory
+{
+public:
+  Trajectory (const MobilityWaypoint *waypoints, uint64_t count)
+    : m_next (waypoints),
+      m_end (waypoints + count),
+      m_time (0),
+      m_stop (0)
+  {
+    m_position[0] = m_position[1] = m_velocity[0] = m_velocity[1] = 0;
+  }
+
+  /// Move to time, same rules as Apply
+  void
+  MoveTo (double time)
+  {
+    for (; m_next != m_end && m_next->time <= time; m_next++)
+      {
+        Move (m_next->time);
+        if (m_next->type == MobilityWaypoint::SET_POSITION)
+          {
+            m_position[0] = std::isnan (m_next->x) ? m_position[0] : m_next->x;
+            m_position[1] = std::isnan (m_next->y) ? m_position[1] : m_next->y;
+            continue;
+          }
+        double dx = m_next->x - m_position[0];
+        double dy = m_next->y - m_position[1];
+        double distance = std::sqrt (dx * dx + dy * dy);
+        m_velocity[0] = m_velocity[1] = 0;
+        if (m_next->speed > 0 && distance > 0)
+          {
+            m_velocity[0] = dx / distance * m_next->speed;
+            m_velocity[1] = dy / distance * m_next->speed;
+            m_stop = m_time + distance / m_next->speed;
+          }
+      }
+    Move (time);
+  }
+
+  double X (void) const { return m_position[0]; }
+  double Y (void) const { return m_position[1]; }
+  double Speed (void) const { return std::sqrt (m_velocity[0] * m_velocity[0] + m_velocity[1] * m_velocity[1]); }
+
+private:
+  void
+  Move (double time)
+  {
+    double moving = std::min (time, m_stop) - m_time;
+    if (moving > 0)
+      {
+        m_position[0] += m_velocity[0] * moving;
+        m_position[1] += m_velocity[1] * moving;
+      }
+    if (time >= m_stop)
+      {
+        m_velocity[0] = m_velocity[1] = 0;
+      }
+    m_time = std::max (m_time, time);
+  }
+
+  const MobilityWaypoint *m_next;
+  const MobilityWaypoint *m_end;
+  double m_time;
+  double m_stop;       //!< arrival at the last destination
+  double m_position[2];
+  double m_velocity[2];
+};
+
+} // namespace
+
+//----------------------------------------------------------------------
+//-- MobilityTraceFile
+//------------------------------------------------------
+
+MobilityTraceFile::MobilityTraceFile ()
+  : m_data (0),
+    m_size (0),
+    m_nodes (0),
+    m_first (0),
+    m_waypoints (0)
+{
+}
+
+MobilityTraceFile::~MobilityTraceFile ()
+{
+  if (m_data != 0)
+    {
+      munmap (m_data, m_size);
+    }
+}
+
+bool
+MobilityTraceFile::Open (const std::string &filename)
+{
+  int fd = open (filename.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Cannot open mobility trace " << filename);
+      return false;
+    }
+  struct stat status;
+  if (fstat (fd, &status) != 0 || (uint64_t) status.st_size < sizeof (MobilityTraceHeader))
+    {
+      close (fd);
+      NS_LOG_ERROR (filename << " is not a binary mobility trace");
+      return false;
+    }
+  void *data = mmap (0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Cannot map mobility trace " << filename);
+      return false;
+    }
+
+  const MobilityTraceHeader *header = (const MobilityTraceHeader *) data;
+  const uint64_t *first = (const uint64_t *) (header + 1);
+  uint64_t size = status.st_size;
+  bool ok = std::memcmp (header->magic, MAGIC, sizeof (MAGIC)) == 0
+            && size >= sizeof (MobilityTraceHeader) + (header->nodes + 1ull) * sizeof (uint64_t);
+  ok = ok && first[header->nodes] == header->waypoints
+       && size >= sizeof (MobilityTraceHeader) + (header->nodes + 1ull) * sizeof (uint64_t)
+                  + header->waypoints * sizeof (MobilityWaypoint);
+  for (uint32_t node = 0; ok && node < header->nodes; node++)
+    {
+      ok = first[node] <= first[node + 1];
+    }
+  if (!ok)
+    {
+      munmap (data, size);
+      NS_LOG_ERROR (filename << " is not a binary mobility trace");
+      return false;
+    }
+
+  if (m_data != 0)
+    {
+      munmap (m_data, m_size);
+    }
+  m_data = data;
+  m_size = size;
+  m_nodes = header->nodes;
+  m_first = first;
+  m_waypoints = (const MobilityWaypoint *) (first + header->nodes + 1);
+  return true;
+}
+
+uint32_t
+MobilityTraceFile::GetNodeCount (void) const
+{
+  return m_nodes;
+}
+
+const MobilityWaypoint *
+MobilityTraceFile::GetWaypoints (uint32_t node, uint64_t &count) const
+{
+  if (node >= m_nodes)
+    {
+      count = 0;
+      return 0;
+    }
+  count = m_first[node + 1] - m_first[node];
+  return m_waypoints + m_first[node];
+}
+
+//----------------------------------------------------------------------
+//-- Conversion
+//------------------------------------------------------
+
+bool
+ConvertNs2MobilityTrace (const std::string &ns2File, const std::string &binaryFile)
+{
+  std::ifstream input (ns2File);
+  if (!input)
+    {
+      NS_LOG_ERROR ("Cannot open ns-2 trace " << ns2File);
+      return false;
+    }
+
+  const double unchanged = std::numeric_limits<double>::quiet_NaN ();
+  std::vector<std::vector<MobilityWaypoint> > nodes;
+  std::string line;
+  uint64_t skipped = 0;
+  while (std::getline (input, line))
+    {
+      std::replace (line.begin (), line.end (), '"', ' ');
+      std::replace (line.begin (), line.end (), '\t', ' ');
+      std::vector<std::string_view> tokens;
+      for (std::string_view token : split (line, " "))
+        {
+          if (!token.empty ())
+            {
+              tokens.push_back (token);
+            }
+        }
+      if (tokens.empty () || tokens[0][0] == '#')
+        {
+          continue;
+        }
+
+      // $node_(ID) set X_ x, the initial position, or $ns_ at T "$node_(ID) ..." later
+      double time = -1;
+      size_t command = 0;
+      if (tokens.size () >= 3 && tokens[0] == "$ns_" && tokens[1] == "at" && ParseNumber (tokens[2], time))
+        {
+          command = 3;
+        }
+      int node = 0;
+      MobilityWaypoint waypoint = {time, unchanged, unchanged, unchanged, 0, MobilityWaypoint::SET_POSITION, 0};
+      double value = 0;
+      bool ok = tokens.size () > command && ParseNode (tokens[command], node);
+      if (ok && tokens.size () == command + 4 && tokens[command + 1] == "set")
+        {
+          ok = ParseNumber (tokens[command + 3], value) && SetAxis (waypoint, tokens[command + 2], value);
+        }
+      else if (ok && tokens.size () == command + 5 && tokens[command + 1] == "setdest")
+        {
+          waypoint.type = MobilityWaypoint::SET_DEST;
+          ok = ParseNumber (tokens[command + 2], waypoint.x) && ParseNumber (tokens[command + 3], waypoint.y)
+               && ParseNumber (tokens[command + 4], waypoint.speed);
+        }
+      else
+        {
+          ok = false;
+        }
+      if (!ok)
+        {
+          skipped++;
+          continue;
+        }
+
+      if ((size_t) node >= nodes.size ())
+        {
+          nodes.resize (node + 1);
+        }
+      std::vector<MobilityWaypoint> &waypoints = nodes[node];
+      if (waypoint.type == MobilityWaypoint::SET_POSITION && !waypoints.empty ()
+          && waypoints.back ().type == MobilityWaypoint::SET_POSITION && waypoints.back ().time == time)
+        {
+          // X_, Y_ and Z_ of the same time make one waypoint
+          MobilityWaypoint &last = waypoints.back ();
+          last.x = std::isnan (waypoint.x) ? last.x : waypoint.x;
+          last.y = std::isnan (waypoint.y) ? last.y : waypoint.y;
+          last.z = std::isnan (waypoint.z) ? last.z : waypoint.z;
+        }
+      else
+        {
+          waypoints.push_back (waypoint);
+        }
+    }
+  if (skipped != 0)
+    {
+      NS_LOG_WARN (skipped << " lines of " << ns2File << " are not node movements and were skipped");
+    }
+  for (std::vector<MobilityWaypoint> &waypoints : nodes)
+    {
+      // the initial position (time -1) first, then by time, in file order for equal times
+      std::stable_sort (waypoints.begin (), waypoints.end (),
+                        [] (const MobilityWaypoint &a, const MobilityWaypoint &b) { return a.time < b.time; });
+    }
+  return WriteMobilityTrace (binaryFile, nodes);
+}
+
+bool
+WriteMobilityTrace (const std::string &binaryFile, const std::vector<std::vector<MobilityWaypoint> > &nodes)
+{
+  MobilityTraceHeader header;
+  std::memcpy (header.magic, MAGIC, sizeof (MAGIC));
+  header.nodes = nodes.size ();
+  header.reserved = 0;
+  header.waypoints = 0;
+  std::vector<uint64_t> first (1, 0);
+  for (const std::vector<MobilityWaypoint> &waypoints : nodes)
+    {
+      header.waypoints += waypoints.size ();
+      first.push_back (header.waypoints);
+    }
+
+  std::ofstream output (binaryFile, std::ios::binary | std::ios::trunc);
+  output.write ((const char *) &header, sizeof (header));
+  output.write ((const char *) first.data (), first.size () * sizeof (uint64_t));
+  for (const std::vector<MobilityWaypoint> &waypoints : nodes)
+    {
+      output.write ((const char *) waypoints.data (), waypoints.size () * sizeof (MobilityWaypoint));
+    }
+  if (!output)
+    {
+      NS_LOG_ERROR ("Cannot write binary trace " << binaryFile);
+      return false;
+    }
+  NS_LOG_INFO (binaryFile << ": " << header.nodes << " nodes, " << header.waypoints << " waypoints");
+  return true;
+}
+
+bool
+IsBinaryMobilityTrace (const std::string &filename)
+{
+  std::ifstream input (filename, std::ios::binary);
+  char magic[sizeof (MAGIC)];
+  return input.read (magic, sizeof (magic)) && std::memcmp (magic, MAGIC, sizeof (MAGIC)) == 0;
+}
+
+std::string
+BinaryMobilityTraceFor (const std::string &ns2File)
+{
+  size_t slash = ns2File.find_last_of ('/');
+  size_t dot = ns2File.find_last_of ('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+      return ns2File + ".bin";
+    }
+  return ns2File.substr (0, dot) + ".bin";
+}
+
+std::string
+FindBinaryMobilityTrace (const std::string &traceFile)
+{
+  if (IsBinaryMobilityTrace (traceFile))
+    {
+      return traceFile;
+    }
+  std::string binaryFile = BinaryMobilityTraceFor (traceFile);
+  return IsBinaryMobilityTrace (binaryFile) ? binaryFile : "";
+}
+
+//----------------------------------------------------------------------
+//-- Subset
+//------------------------------------------------------
+
+bool
+SubsetMobilityTrace (const MobilityTraceFile &trace, const std::vector<std::vector<int> > &clusters,
+                     double start, double stop, double range, double step,
+                     const std::string &binaryFile, std::vector<int> &kept)
+{
+  uint32_t n = trace.GetNodeCount ();
+  std::vector<Trajectory> trajectories;
+  for (uint32_t node = 0; node < n; node++)
+    {
+      uint64_t count = 0;
+      const MobilityWaypoint *waypoints = trace.GetWaypoints (node, count);
+      trajectories.push_back (Trajectory (waypoints, count));
+    }
+
+  std::vector<bool> keep (n, false);
+  std::vector<int> members;
+  for (const std::vector<int> &cluster : clusters)
+    {
+      for (int node : cluster)
+        {
+          if (node >= 0 && (uint32_t) node < n)
+            {
+              keep[node] = true;
+              members.push_back (node);
+            }
+        }
+    }
+
+  SpatialGrid grid (range);
+  std::vector<double> x (n);
+  std::vector<double> y (n);
+  std::vector<uint32_t> near;
+  for (double time = start; time <= stop + step / 2; time += step)
+    {
+      double fastest = 0;
+      for (uint32_t node = 0; node < n; node++)
+        {
+          trajectories[node].MoveTo (std::min (time, stop));
+          x[node] = trajectories[node].X ();
+          y[node] = trajectories[node].Y ();
+          fastest = std::max (fastest, trajectories[node].Speed ());
+        }
+      grid.Build (x, y);
+      for (int member : members)
+        {
+          // both may move toward each other until the middle of the step
+          double margin = (trajectories[member].Speed () + fastest) * step / 2;
+          grid.Neighbors (member, range + margin, near);
+          for (uint32_t node : near)
+            {
+              keep[node] = true;
+            }
+        }
+    }
+
+  kept.clear ();
+  std::vector<std::vector<MobilityWaypoint> > nodes;
+  for (uint32_t node = 0; node < n; node++)
+    {
+      if (!keep[node])
+        {
+          continue;
+        }
+      uint64_t count = 0;
+      const MobilityWaypoint *waypoints = trace.GetWaypoints (node, count);
+      kept.push_back (node);
+      nodes.push_back (std::vector<MobilityWaypoint> ());
+      for (uint64_t k = 0; k < count && waypoints[k].time <= stop; k++)
+        {
+          nodes.back ().push_back (waypoints[k]);
+        }
+    }
+  return WriteMobilityTrace (binaryFile, nodes);
+}
+
+//----------------------------------------------------------------------
+//-- BinaryMobilityHelper
+//------------------------------------------------------
+
+BinaryMobilityHelper::BinaryMobilityHelper (std::string filename)
+  : m_filename (filename)
+{
+}
+
+void
+BinaryMobilityHelper::Install (void) const
+{
+  std::shared_ptr<MobilityTraceFile> file = std::make_shared<MobilityTraceFile> ();
+  if (!file->Open (m_filename))
+    {
+      NS_FATAL_ERROR ("Cannot read binary mobility trace " << m_filename);
+    }
+  uint32_t nodes = std::min<uint32_t> (file->GetNodeCount (), ns3::NodeList::GetNNodes ());
+  for (uint32_t id = 0; id < nodes; id++)
+    {
+      InstallOn (file, ns3::NodeList::GetNode (id));
+    }
+}
+
+void
+BinaryMobilityHelper::Install (ns3::NodeContainer c) const
+{
+  std::shared_ptr<MobilityTraceFile> file = std::make_shared<MobilityTraceFile> ();
+  if (!file->Open (m_filename))
+    {
+      NS_FATAL_ERROR ("Cannot read binary mobility trace " << m_filename);
+    }
+  for (uint32_t i = 0; i < c.GetN (); i++)
+    {
+      InstallOn (file, c.Get (i));
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef RUI_MOBILITY_TRACE_H
+#define RUI_MOBILITY_TRACE_H
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ns3/node-container.h"
+
+/**
+ * \brief Binary mobility trace, converted once from an ns-2 trace.
+ *
+ * Layout, native byte order:
+ *
+ *   magic "CRSMOB1\0" (8) | nodes (32) | reserved (32) | waypoints (64)
+ *   first waypoint of each node, nodes + 1 values (64 each)
+ *   waypoints, grouped by node and sorted by time within a node
+ *
+ * A file is memory-mapped, so only the pages of the waypoints the
+ * simulation has reached are read.
+ */
+struct MobilityWaypoint
+{
+  enum Type
+  {
+    SET_POSITION = 0, //!< jump to (x, y, z), a NaN coordinate is left unchanged
+    SET_DEST = 1      //!< move toward (x, y) at speed, then stop
+  };
+
+  double time;
+  double x;
+  double y;
+  double z;
+  double speed;
+  uint32_t type;
+  uint32_t reserved;
+};
+
+class MobilityTraceFile
+{
+public:
+  MobilityTraceFile ();
+  ~MobilityTraceFile ();
+
+  /// Map a binary trace, false if it cannot be read or is not one
+  bool Open (const std::string &filename);
+  uint32_t GetNodeCount (void) const;
+  /// Waypoints of a node, count of them in count
+  const MobilityWaypoint *GetWaypoints (uint32_t node, uint64_t &count) const;
+
+private:
+  MobilityTraceFile (const MobilityTraceFile &);
+  MobilityTraceFile &operator= (const MobilityTraceFile &);
+
+  void *m_data;
+  uint64_t m_size;
+  uint32_t m_nodes;
+  const uint64_t *m_first;
+  const MobilityWaypoint *m_waypoints;
+};
+
+/// Convert an ns-2 trace (e.g. from the SUMO traceExporter) to a binary trace
+bool ConvertNs2MobilityTrace (const std::string &ns2File, const std::string &binaryFile);
+/// Write a binary trace, the waypoints of node i in nodes[i], sorted by time
+bool WriteMobilityTrace (const std::string &binaryFile, const std::vector<std::vector<MobilityWaypoint> > &nodes);
+/**
+ * \brief Keep the vehicles that come near the clusters, renumbered.
+ *
+ * A vehicle is kept if, between start and stop (s), it comes within range
+ * (m) of a vehicle of clusters (node IDs of trace), checked every step
+ * (s) with a margin for the distance both can cover in half a step. The
+ * vehicles of clusters are always kept. Waypoints after stop are dropped.
+ *
+ * \param kept node ID in trace of each vehicle of the subset, by increasing ID
+ * \return false if binaryFile cannot be written
+ */
+bool SubsetMobilityTrace (const MobilityTraceFile &trace, const std::vector<std::vector<int> > &clusters,
+                          double start, double stop, double range, double step,
+                          const std::string &binaryFile, std::vector<int> &kept);
+/// True if filename is a binary trace
+bool IsBinaryMobilityTrace (const std::string &filename);
+/// Name of the binary trace of an ns-2 trace: the extension replaced by .bin
+std::string BinaryMobilityTraceFor (const std::string &ns2File);
+/// traceFile if it is a binary trace, else its .bin version if that is one, else ""
+std::string FindBinaryMobilityTrace (const std::string &traceFile);
+
+/**
+ * \brief Replacement of Ns2MobilityHelper for binary traces.
+ *
+ * Like Ns2MobilityHelper, node i of the trace moves the node with ID i
+ * through a ConstantVelocityMobilityModel. Only the next waypoint of each
+ * node is scheduled, the following one when it is reached.
+ */
+class BinaryMobilityHelper
+{
+public:
+  BinaryMobilityHelper (std::string filename);
+
+  /// Install on every node of the trace that exists in the simulation
+  void Install (void) const;
+  /// Install on the nodes of c that appear in the trace
+  void Install (ns3::NodeContainer c) const;
+
+private:
+  std::string m_filename;
+};
+
+#endif
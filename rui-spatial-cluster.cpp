@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include "rui-spatial-cluster.h"
+
+//----------------------------------------------------------------------
+//-- SpatialGrid
+//------------------------------------------------------
+
+SpatialGrid::SpatialGrid (double cell)
+  : m_requestedCell (cell),
+    m_cell (cell),
+    m_minX (0),
+    m_minY (0),
+    m_cols (1),
+    m_rows (1),
+    m_x (),
+    m_y (),
+    m_cellStart (2, 0),
+    m_points ()
+{
+}
+
+void
+SpatialGrid::Build (const std::vector<double> &x, const std::vector<double> &y)
+{
+  m_x = x;
+  m_y = y;
+  m_cell = m_requestedCell;
+  m_cols = 1;
+  m_rows = 1;
+  if (!x.empty ())
+    {
+      double maxX = *std::max_element (x.begin (), x.end ());
+      double maxY = *std::max_element (y.begin (), y.end ());
+      m_minX = *std::min_element (x.begin (), x.end ());
+      m_minY = *std::min_element (y.begin (), y.end ());
+      // a sparse area would make too many empty cells, so the cell grows with the area
+      double max_cells = std::max<double> (1024, 4.0 * x.size ());
+      double cells = ((maxX - m_minX) / m_cell + 1) * ((maxY - m_minY) / m_cell + 1);
+      if (cells > max_cells)
+        {
+          m_cell = m_cell * std::sqrt (cells / max_cells);
+        }
+      m_cols = (uint32_t) ((maxX - m_minX) / m_cell) + 1;
+      m_rows = (uint32_t) ((maxY - m_minY) / m_cell) + 1;
+    }
+
+  // counting sort of the points by cell
+  m_cellStart.assign ((size_t) m_cols * m_rows + 1, 0);
+  std::vector<uint32_t> cell_of (x.size ());
+  for (uint32_t i = 0; i < x.size (); i++)
+    {
+      cell_of[i] = CellOf (x[i], y[i]);
+      m_cellStart[cell_of[i] + 1]++;
+    }
+  for (uint32_t c = 0; c + 1 < m_cellStart.size (); c++)
+    {
+      m_cellStart[c + 1] += m_cellStart[c];
+    }
+  std::vector<uint32_t> next (m_cellStart.begin (), m_cellStart.end () - 1);
+  m_points.resize (x.size ());
+  for (uint32_t i = 0; i < x.size (); i++)
+    {
+      m_points[next[cell_of[i]]++] = i;
+    }
+}
+
+uint32_t
+SpatialGrid::CellOf (double x, double y) const
+{
+  double cx = std::floor ((x - m_minX) / m_cell);
+  double cy = std::floor ((y - m_minY) / m_cell);
+  uint32_t col = (uint32_t) std::min<double> (std::max<double> (cx, 0), m_cols - 1);
+  uint32_t row = (uint32_t) std::min<double> (std::max<double> (cy, 0), m_rows - 1);
+  return row * m_cols + col;
+}
+
+void
+SpatialGrid::Query (double x, double y, double range, std::vector<uint32_t> &points) const
+{
+  points.clear ();
+  int32_t reach = (int32_t) std::ceil (range / m_cell);
+  uint32_t center = CellOf (x, y);
+  int32_t col = center % m_cols;
+  int32_t row = center / m_cols;
+  double range2 = range * range;
+  for (int32_t r = std::max (row - reach, 0); r <= std::min<int32_t> (row + reach, m_rows - 1); r++)
+    {
+      for (int32_t c = std::max (col - reach, 0); c <= std::min<int32_t> (col + reach, m_cols - 1); c++)
+        {
+          uint32_t cell = r * m_cols + c;
+          for (uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++)
+            {
+              uint32_t p = m_points[k];
+              double dx = m_x[p] - x;
+              double dy = m_y[p] - y;
+              if (dx * dx + dy * dy <= range2)
+                {
+                  points.push_back (p);
+                }
+            }
+        }
+    }
+}
+
+void
+SpatialGrid::Neighbors (uint32_t i, double range, std::vector<uint32_t> &neighbors) const
+{
+  Query (m_x[i], m_y[i], range, neighbors);
+  neighbors.erase (std::remove (neighbors.begin (), neighbors.end (), i), neighbors.end ());
+}
+
+//----------------------------------------------------------------------
+//-- FormSpatialClusters
+//------------------------------------------------------
+
+std::vector<std::vector<int> >
+FormSpatialClusters (const std::vector<int> &ids,
+                     const std::vector<double> &x,
+                     const std::vector<double> &y,
+                     double range, uint32_t size,
+                     uint32_t head_index, uint32_t max_hops,
+                     uint32_t max_clusters)
+{
+  std::vector<std::vector<int> > clusters;
+  uint32_t n = ids.size ();
+  if (size == 0 || size > n || head_index >= size)
+    {
+      return clusters;
+    }
+
+  SpatialGrid grid (range);
+  grid.Build (x, y);
+  std::vector<std::vector<uint32_t> > adjacency (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      grid.Neighbors (i, range, adjacency[i]);
+    }
+
+  // the vehicles with the most neighbors are tried as heads first
+  std::vector<uint32_t> order (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      order[i] = i;
+    }
+  std::stable_sort (order.begin (), order.end (), [&adjacency] (uint32_t a, uint32_t b) {
+    return adjacency[a].size () > adjacency[b].size ();
+  });
+
+  std::vector<bool> assigned (n, false);
+  std::vector<int32_t> hop (n, -1);
+  std::vector<uint32_t> members;
+  std::vector<uint32_t> level;
+  std::vector<uint32_t> next_level;
+  for (uint32_t h : order)
+    {
+      if (assigned[h])
+        {
+          continue;
+        }
+
+      // breadth first over the free vehicles, the closest ones first in each hop
+      members.assign (1, h);
+      hop[h] = 0;
+      level.assign (1, h);
+      for (uint32_t d = 1; d <= max_hops && members.size () < size && !level.empty (); d++)
+        {
+          next_level.clear ();
+          for (uint32_t u : level)
+            {
+              for (uint32_t v : adjacency[u])
+                {
+                  if (!assigned[v] && hop[v] < 0)
+                    {
+                      hop[v] = d;
+                      next_level.push_back (v);
+                    }
+                }
+            }
+          std::sort (next_level.begin (), next_level.end (), [&] (uint32_t a, uint32_t b) {
+            double da = (x[a] - x[h]) * (x[a] - x[h]) + (y[a] - y[h]) * (y[a] - y[h]);
+            double db = (x[b] - x[h]) * (x[b] - x[h]) + (y[b] - y[h]) * (y[b] - y[h]);
+            return da < db || (da == db && a < b);
+          });
+          for (uint32_t v : next_level)
+            {
+              if (members.size () < size)
+                {
+                  members.push_back (v);
+                }
+            }
+          level.swap (next_level);
+        }
+      for (uint32_t v : members)
+        {
+          hop[v] = -1;
+        }
+      for (uint32_t v : level)
+        {
+          hop[v] = -1;
+        }
+      if (members.size () < size)
+        {
+          continue;
+        }
+
+      // the member with the smallest total hop count to the others becomes the head, as long
+      // as every member stays within max_hops of it (true for h)
+      std::vector<int32_t> local (n, -1);
+      for (uint32_t k = 0; k < size; k++)
+        {
+          local[members[k]] = k;
+        }
+      uint32_t best = 0;
+      uint64_t best_total = std::numeric_limits<uint64_t>::max ();
+      for (uint32_t k = 0; k < size; k++)
+        {
+          std::vector<uint32_t> dist (size, std::numeric_limits<uint32_t>::max ());
+          std::deque<uint32_t> queue (1, k);
+          dist[k] = 0;
+          uint64_t total = 0;
+          uint32_t farthest = 0;
+          while (!queue.empty ())
+            {
+              uint32_t u = queue.front ();
+              queue.pop_front ();
+              total += dist[u];
+              farthest = std::max (farthest, dist[u]);
+              for (uint32_t v : adjacency[members[u]])
+                {
+                  if (local[v] >= 0 && dist[local[v]] == std::numeric_limits<uint32_t>::max ())
+                    {
+                      dist[local[v]] = dist[u] + 1;
+                      queue.push_back (local[v]);
+                    }
+                }
+            }
+          bool reaches_all = std::find (dist.begin (), dist.end (), std::numeric_limits<uint32_t>::max ()) == dist.end ();
+          if (reaches_all && farthest <= max_hops && total < best_total)
+            {
+              best_total = total;
+              best = k;
+            }
+        }
+
+      std::vector<int> cluster;
+      for (uint32_t k = 0; k < size; k++)
+        {
+          if (k != best)
+            {
+              cluster.push_back (ids[members[k]]);
+            }
+          assigned[members[k]] = true;
+        }
+      cluster.insert (cluster.begin () + head_index, ids[members[best]]);
+      clusters.push_back (cluster);
+      if (max_clusters != 0 && clusters.size () == max_clusters)
+        {
+          break;
+        }
+    }
+  return clusters;
+}
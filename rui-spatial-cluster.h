@@ -0,0 +1,65 @@
+#ifndef RUI_SPATIAL_CLUSTER_H
+#define RUI_SPATIAL_CLUSTER_H
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Uniform grid over 2D positions for radius queries.
+ *
+ * The points are bucketed by cell with a counting sort, so building is
+ * O(N) and a query only looks at the cells that overlap its radius.
+ */
+class SpatialGrid
+{
+public:
+  /// cell: side of a cell, usually the radio range
+  SpatialGrid (double cell);
+
+  void Build (const std::vector<double> &x, const std::vector<double> &y);
+  /// Indexes of the points within range of point i, i excluded
+  void Neighbors (uint32_t i, double range, std::vector<uint32_t> &neighbors) const;
+  /// Indexes of the points within range of (x, y)
+  void Query (double x, double y, double range, std::vector<uint32_t> &points) const;
+
+private:
+  uint32_t CellOf (double x, double y) const;
+
+  double m_requestedCell;
+  double m_cell;        //!< grows over sparse areas to bound the number of cells
+  double m_minX;
+  double m_minY;
+  uint32_t m_cols;
+  uint32_t m_rows;
+  std::vector<double> m_x;
+  std::vector<double> m_y;
+  std::vector<uint32_t> m_cellStart; //!< first entry of each cell in m_points, m_cols * m_rows + 1 values
+  std::vector<uint32_t> m_points;    //!< point indexes sorted by cell
+};
+
+/**
+ * \brief Form clusters of exactly size vehicles from their positions.
+ *
+ * Vehicles within range of each other are one hop apart. Heads are tried
+ * by decreasing number of neighbors; a head takes the closest free
+ * vehicles in hops (at most max_hops) until the cluster is full, then the
+ * member with the smallest total hop count to the others, all of them within
+ * max_hops, becomes the head. Vehicles left over stay out of any cluster.
+ *
+ * \param ids node ID of each position
+ * \param x x of each vehicle
+ * \param y y of each vehicle
+ * \param range radio range (m)
+ * \param size vehicles per cluster, head included
+ * \param head_index position of the head in each returned cluster
+ * \param max_hops largest hop count between a member and the head
+ * \param max_clusters stop after that many clusters, 0 for no limit
+ * \return node IDs of each cluster
+ */
+std::vector<std::vector<int> > FormSpatialClusters (const std::vector<int> &ids,
+                                                    const std::vector<double> &x,
+                                                    const std::vector<double> &y,
+                                                    double range, uint32_t size,
+                                                    uint32_t head_index, uint32_t max_hops,
+                                                    uint32_t max_clusters);
+
+#endif
@@ -1,36 +1,40 @@
 #ifndef RUIVEHICLEBETAH
 #define RUIVEHICLEBETAH
+#include <cstdint>
 #include <map>
+#include <vector>
 #include "ns3/ipv4-address.h"
-#include <random>
 
-static int group_size = 20; //The total number of vehicles in a group.
-static double vehicle_beta[20] = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1.0, 0.15, 0.25, 0.35, 0.45, 0.55, 0.65, 0.75, 0.85, 0.95, 0.98};
+//The cluster settings below are defined in rui-cluster-config.cpp and set at run time by ClusterConfig,
+//by default the 20-vehicle cluster of the paper.
+extern int group_size; //The total number of vehicles in a group.
+extern std::vector<double> vehicle_beta;
 //used for network encoding
-static double vehicle_obser[20] = {51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70};
+extern std::vector<double> vehicle_obser;
 
-static int node_list[20] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
-static int head_node = 10; //index of the vehicle you set as the cluster head. 
+extern std::vector<int> node_list; //node IDs of the (first) cluster
+extern std::vector<std::vector<int> > cluster_list; //node IDs of every cluster, for programs that run several clusters
+extern int head_node; //index of the vehicle you set as the cluster head. 
+extern double cluster_form_time; //time (s) the clusters are formed from the vehicle positions, <0 to use cluster_list as configured
+extern double cluster_range; //radio range (m) of one hop when forming clusters
+extern int cluster_max_hops; //largest hop count between a member and its head when forming clusters
+extern int cluster_max_count; //largest number of clusters formed from positions, 0 for no limit
 
+//The state of a simulation (maps from addresses and node IDs to vehicles, masked observations,
+//statistics of the routers) is kept in its CrsContext (rui-crs-context.h).
 
-extern std::map<int, int> node_ID_to_index;
-//used as observation values/machine learning results
+extern int num_entries; //entries of an instance
 
-extern std::vector<double> mask_obser;
-extern std::vector<std::vector<double>> mask_obser_instance;
+extern uint64_t mask_key; //key of the pairwise masks (PairwiseMasker), 0 for the masks of the paper (MaskObservation)
+extern int mask_bits; //bits of each pairwise mask word
 
-static int num_entries = 2000;
+extern bool float_payload; //--floatPayload: send the values of coded packets as float32 instead of float64
+extern int fixed_beta_bits; //--fixedPoint: send the values quantized to integers (Quantize), the betas being round(beta * 2^bits); 0 for floating point
+extern int fixed_point_width; //--fixedPointWidth: bits of the quantized values, 8 or 16
+extern bool gf_coding; //--gfCoding: send the values as integers coded over GF(2^8) (rui-gf256.h), the betas are not used
 
-extern std::map<ns3::Ipv4Address, int> address_to_id; //to map IP address to vehicle IDs 
 
-
-extern std::map<int, int> stat_network_coding_time; //the time used for network_coding part for each router/node in the whole process 
-
-
-static std::random_device rd;
-static std::mt19937 gen(rd());
-static std::uniform_int_distribution<> dis(0, 100); //random numbers
-static double error_rate = 0.01;//0.03; //the constant drop rate
+extern double error_rate; //the constant drop rate, 0.01 by default, set with --errorRate
 // In the emulated scenario, the constant drop rate is set to 1% and 2%. In the realistic scenario, we further set the constant drop rate to 0%, 1%, 2% and 3%.
 
 
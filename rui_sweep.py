@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+# Rui: runs a simulation over a grid of parameters, in parallel, and merges the
+# rui_statistic_*.csv files of the runs into one table per file.
+#
+# Each run is a separate process in its own directory under --out, with
+# --RngRun=<replicate> so a run is reproduced by its parameters and replicate,
+# and the same replicate of two configurations sees the same random streams.
+# Run it in the ns-3 shell, so the binary finds the ns-3 libraries:
+#
+#   ./waf shell
+#   python3 rui_sweep.py --program=build/scratch/vanet-routing-Rui \
+#       --param errorRate=0,0.01,0.05 --param clusterSize=10,20 --runs=10 \
+#       --fixed totaltime=40 --out=sweep
+#
+# Finished runs are skipped when the same sweep is started again.
+# summary_<file>.csv has, for each configuration, the number of replicates n,
+# then the mean and 95% confidence interval of each column over the replicates:
+# the rows of one run are averaged first, so each run counts once. Files with
+# one row per cluster are grouped by their cluster column (--group), giving one
+# summary line per configuration and cluster.
+
+import argparse
+import csv
+import glob
+import itertools
+import math
+import os
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+# two-sided 95% quantiles of the Student t distribution, by degrees of freedom
+T95 = [0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+
+def t95(df):
+    if df < len(T95):
+        return T95[df]
+    if df < 60:
+        return 2.000
+    if df < 120:
+        return 1.980
+    return 1.960
+
+
+def parse_param(text):
+    name, _, values = text.partition("=")
+    if not name or not values:
+        sys.exit("bad --param %s, expected name=v1,v2,..." % text)
+    return name, values.split(",")
+
+
+def run_dir(out, config, replicate):
+    parts = ["%s=%s" % (name, value) for name, value in config]
+    return os.path.join(out, "_".join(parts) or "default", "run%d" % replicate)
+
+
+def run(program, fixed, links, config, replicate, directory):
+    done = os.path.join(directory, "done")
+    if os.path.exists(done):
+        return 0
+    os.makedirs(directory, exist_ok=True)
+    for statistic in glob.glob(os.path.join(directory, "rui_statistic_*.csv")):
+        os.remove(statistic)  # appended by the simulation, drop the rows of an unfinished run
+    for link in links:
+        target = os.path.join(directory, os.path.basename(os.path.normpath(link)))
+        if not os.path.lexists(target):
+            os.symlink(os.path.abspath(link), target)
+    args = [os.path.abspath(program)]
+    args += ["--%s=%s" % (name, value) for name, value in fixed + list(config)]
+    args.append("--RngRun=%d" % replicate)
+    with open(os.path.join(directory, "log.txt"), "w") as log:
+        log.write(" ".join(args) + "\n")
+        log.flush()
+        code = subprocess.call(args, cwd=directory, stdout=log, stderr=subprocess.STDOUT)
+    if code == 0:
+        open(done, "w").close()
+    else:
+        print("run failed (%d), see %s" % (code, os.path.join(directory, "log.txt")), file=sys.stderr)
+    return code
+
+
+# statistic files with one row per cluster, and their cluster column (1-based)
+GROUPS = {"rui_statistic_clusters.csv": 1}
+
+
+def read_rows(filename):
+    """Numeric rows of a statistic file, empty fields kept as None so the columns stay aligned."""
+    rows = []
+    with open(filename) as f:
+        for line in f:
+            fields = [field.strip() for field in line.rstrip("\n").split(",")]
+            try:
+                row = [float(field) if field else None for field in fields]
+            except ValueError:
+                continue  # header or text
+            while row and row[-1] is None:
+                row.pop()  # a trailing "," is no column
+            if row:
+                rows.append(row)
+    return rows
+
+
+def replicate_means(rows, width):
+    """Mean of each column over the rows of one run, None where the run has no value."""
+    means = []
+    for i in range(width):
+        values = [row[i] for row in rows if i < len(row) and row[i] is not None]
+        means.append(sum(values) / len(values) if values else None)
+    return means
+
+
+def summarize(out, names, grid, runs, columns, groups):
+    files = set()
+    for config in grid:
+        for replicate in range(1, runs + 1):
+            for statistic in glob.glob(os.path.join(run_dir(out, config, replicate), "rui_statistic_*.csv")):
+                files.add(os.path.basename(statistic))
+    for statistic in sorted(files):
+        group = groups.get(statistic, 0) - 1  # column of the cluster, -1 if none
+        runs_rows = []
+        width = 0
+        for config in grid:
+            for replicate in range(1, runs + 1):
+                filename = os.path.join(run_dir(out, config, replicate), statistic)
+                if os.path.exists(filename):
+                    rows = read_rows(filename)
+                    width = max([width] + [len(row) for row in rows])
+                    runs_rows.append((config, rows))
+        # one value per column and run, for each configuration (and cluster)
+        table = {}
+        for config, rows in runs_rows:
+            by_key = {}
+            for row in rows:
+                key = row[group] if 0 <= group < len(row) else None
+                by_key.setdefault(key, []).append(row)
+            for key, key_rows in by_key.items():
+                table.setdefault((config, key), []).append(replicate_means(key_rows, width))
+        labels = columns.get(statistic, [])
+        labels = labels + ["c%d" % (i + 1) for i in range(len(labels), width)]
+        summary = os.path.join(out, "summary_" + statistic)
+        with open(summary, "w", newline="") as f:
+            writer = csv.writer(f)
+            header = list(names) + ([labels[group]] if group >= 0 else []) + ["n"]
+            for i, label in enumerate(labels[:width]):
+                if i != group:
+                    header += [label + "_mean", label + "_ci95"]
+            writer.writerow(header)
+            for config in grid:
+                keys = sorted(k for c, k in table if c == config and k is not None)
+                keys += [None] if (config, None) in table else []
+                for key in keys:
+                    means = table[(config, key)]
+                    line = [value for _, value in config]
+                    if group >= 0:
+                        line.append("" if key is None else "%g" % key)
+                    line.append(len(means))
+                    for i in range(width):
+                        if i != group:
+                            line += mean_ci([m[i] for m in means if m[i] is not None])
+                    writer.writerow(line)
+        print("wrote", summary)
+
+
+def mean_ci(values):
+    n = len(values)
+    if n == 0:
+        return ["", ""]
+    mean = sum(values) / n
+    if n == 1:
+        return [mean, ""]
+    variance = sum((v - mean) ** 2 for v in values) / (n - 1)
+    return [mean, t95(n - 1) * math.sqrt(variance / n)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="parallel parameter sweep of a CRS simulation")
+    parser.add_argument("--program", required=True, help="built simulation binary, e.g. build/scratch/vanet-routing-Rui")
+    parser.add_argument("--param", action="append", default=[], help="swept option, name=v1,v2,... (repeat for a grid)")
+    parser.add_argument("--fixed", action="append", default=[], help="option given to every run, name=value")
+    parser.add_argument("--runs", type=int, default=10, help="replicates of each configuration, --RngRun=1..runs")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="simulations run at once")
+    parser.add_argument("--out", default="sweep", help="directory of the runs and summaries")
+    parser.add_argument("--link", action="append", default=[], help="file or directory linked into each run directory, e.g. tracefile")
+    parser.add_argument("--columns", action="append", default=[],
+                        help="column names of a statistic file, file=name1,name2,... (c1, c2, ... otherwise)")
+    parser.add_argument("--group", action="append", default=[],
+                        help="statistic file with one row per cluster and its cluster column, file=column (1-based); "
+                             "rui_statistic_clusters.csv=1 by default")
+    parser.add_argument("--summary-only", action="store_true", help="only merge the finished runs")
+    args = parser.parse_args()
+
+    swept = [parse_param(p) for p in args.param]
+    fixed = []
+    for f in args.fixed:
+        name, _, value = f.partition("=")
+        fixed.append((name, value))
+    columns = {}
+    for c in args.columns:
+        name, values = parse_param(c)
+        columns[name] = values
+    groups = dict(GROUPS)
+    for g in args.group:
+        name, _, column = g.partition("=")
+        if not column.isdigit():
+            sys.exit("bad --group %s, expected file=column" % g)
+        groups[name] = int(column)
+    names = [name for name, _ in swept]
+    grid = [tuple(zip(names, values)) for values in itertools.product(*[values for _, values in swept])]
+
+    if not args.summary_only:
+        jobs = [(config, replicate) for config in grid for replicate in range(1, args.runs + 1)]
+        print("%d configurations, %d runs on %d cores" % (len(grid), len(jobs), args.jobs))
+        with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+            codes = list(pool.map(lambda job: run(args.program, fixed, args.link, job[0], job[1],
+                                                  run_dir(args.out, job[0], job[1])), jobs))
+        failed = sum(1 for code in codes if code != 0)
+        if failed:
+            print("%d runs failed" % failed, file=sys.stderr)
+    summarize(args.out, names, grid, args.runs, columns, groups)
+
+
+if __name__ == "__main__":
+    main()
@@ -7,6 +7,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <cmath>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -32,15 +33,17 @@
 #include <map>
 #include "ns3/rui-vehicle-beta.h"
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-coded-packet.h"
+#include "ns3/rui-cluster-config.h"
+#include "ns3/rui-crs-context.h"
 
 
 using namespace ns3;
 using namespace dsr;
 using namespace std;
 
-extern map<Ipv4Address, int> address_to_id; //Rui: to map IP adress with user ID
-extern vector<double> mask_obser; //Rui: To simulate the observation value/machine learning result for all users
-extern map<int, int> node_ID_to_index;
+static double speed_mean = 22.22; //Rui: --speedMean, mean speed (m/s) of mobility model 5
+static double speed_variance = 0.07716; //Rui: --speedVariance, the std variable of the paper squared
 
 NS_LOG_COMPONENT_DEFINE ("vanet-routing-rui");
 
@@ -107,7 +110,7 @@ public:
 
   list<Ipv4Address> GetReceiveList (); //Rui: received from which members
 
-  list<string> GetReceiveContent (); //Rui: the received values, to calculate the avearage 
+  list<CodedPacketHeader> GetReceiveContent (); //Rui: the received values, to calculate the avearage 
 
   map<int, Time> GetEndDelay (); //Rui: for statistic: end-to-end delay
 
@@ -116,6 +119,8 @@ public:
   void AddRecoveryTime(int time_duration); //Rui: for statistic: recovery time
 
   int GetRecoveryTime();//Rui: for statistic: recovery time
+  Time GetTimeToRecover();//Rui: for statistic: first send to all members known at the head, negative if never
+  Ptr<CrsContext> GetCrsContext ();//Rui: the CRS state of this simulation, with the statistics of the routers
 
 
 
@@ -175,10 +180,13 @@ private:
   std::string m_protocolName; ///< protocol name
   int m_log; ///< log
   list<Ipv4Address> receive_list; 
-  list<string> receive_content; 
+  list<CodedPacketHeader> receive_content; 
   map<int, Time> end_to_end_delay; 
   map<int, int> stat_masking_time; 
   int stat_recovery_and_unmasking_time; 
+  Time m_first_send; //Rui: earliest send time among the received packets
+  Time m_time_to_recover; 
+  Ptr<CrsContext> m_crsContext; //Rui: the CRS state of this simulation, shared with the routers
   
 };
 
@@ -194,7 +202,7 @@ RoutingHelper::GetTypeId (void)
 }
 
 RoutingHelper::RoutingHelper ()
-  : m_data_mangement_helper (group_size-1),
+  : m_data_mangement_helper (group_size-1, vehicle_beta, num_entries),
     m_data_recovery_helper (),
     m_TotalSimTime (300.01),
     m_protocol (0),
@@ -206,7 +214,10 @@ RoutingHelper::RoutingHelper ()
     receive_content (),
     end_to_end_delay (),
     stat_masking_time (),
-    stat_recovery_and_unmasking_time (0)
+    stat_recovery_and_unmasking_time (0),
+    m_first_send (Time::Max ()),
+    m_time_to_recover (Seconds (-1)),
+    m_crsContext (CreateObject<CrsContext> ())
     
 {
 }
@@ -230,6 +241,7 @@ RoutingHelper::Install (NodeContainer & c,
   m_routingTables = routingTables;
 
   SetupRoutingProtocol (c);
+  m_crsContext->Install (c);
   AssignIpAddresses (c, d, i); 
   SetupRoutingMessages (c, i);
 }
@@ -332,33 +344,24 @@ RoutingHelper::AssignIpAddresses (NodeContainer & c, NetDeviceContainer & d,
   for (int i = 0; i < c.GetN(); ++i)
   {
     //Ipv4Address address_ipv4;
-    address_to_id.insert(make_pair(adhocTxInterfaces.GetAddress(i),c.Get(i)->GetId()));//Ipv4Address(d.Get(i)->GetAddress())
+    m_crsContext->address_to_id.Insert(adhocTxInterfaces.GetAddress(i).Get (),c.Get(i)->GetId());//Ipv4Address(d.Get(i)->GetAddress())
   }
 
 }
 
-//Rui: to mask a data. The masks can be chosen with a more complex method.
+//Rui: to mask a data, with the masks of the coding core (rui-crs-core.h): pairwise
+//masks with --maskKey, else the masks of the paper.
 int
 Masking (int raw_obser, int nodeID)
 {
-
   NS_LOG_INFO("raw_obser: "<<raw_obser);
-  double mask = 0;
-  for (int j=nodeID+1; j<group_size; j++)
-  {
-    mask = ( j + nodeID ) % 10; 
-    raw_obser = raw_obser + mask;
-    //NS_LOG_DEBUG ("+" << mask);
-  }
-  for (int j=0; j<nodeID; j++)
+  if (mask_key != 0)
   {
-    mask = ( j + nodeID ) % 10; 
-    raw_obser = raw_obser - mask;
-    //NS_LOG_DEBUG ( "-" << mask);
+    double masked = raw_obser;
+    PairwiseMasker (mask_key, group_size, mask_bits).Mask (nodeID, &masked, 1);
+    return masked;
   }
-  // node_observ = node_observ % 100;
-  //cout << endl;
-  return raw_obser; //masked value
+  return MaskObservation (raw_obser, nodeID, group_size); //masked value
 }
 
 
@@ -366,14 +369,34 @@ void
 RoutingHelper::SendOnePacket (Ptr<Socket> socket)
 {
   int nodeID = socket->GetNode ()->GetId ();
-  int node_index = node_ID_to_index.at(nodeID); 
+  int node_index = m_crsContext->node_ID_to_index.At(nodeID); 
   int node_observ = vehicle_obser[node_index]; //observation value
 
 
-  std::ostringstream data; data << node_observ << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::ORIGINAL);
+  crsHeader.SetFloat32 (float_payload);
+  crsHeader.SetGroupSize (group_size);
+  if (fixed_beta_bits > 0)
+  {
+    //at the scale of the masked value the vehicle adds as a relay, so the head sees one scale per vehicle
+    int8_t scale = m_crsContext->quantized_obser[node_index].scale;
+    crsHeader.SetFixedValues (scale, vector<int64_t> (1, llround (ldexp (node_observ, -scale))));//coded in int64 by the relays
+  }
+  else if (gf_coding)
+  {
+    if (!crsHeader.SetFieldValues (vector<double> (1, node_observ), 0, m_crsContext->fixed_value_bytes))//coded over GF(2^8) by the relays
+    {
+      NS_FATAL_ERROR ("The observation " << node_observ << " does not fit the field symbols");
+    }
+  }
+  else
+  {
+    crsHeader.SetValues (vector<double> (1, node_observ));
+  }
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
 
   TimestampTag timestamp;
   timestamp.SetTimestamp (Simulator::Now ());
@@ -389,10 +412,11 @@ RoutingHelper::SendOnePacket (Ptr<Socket> socket)
 void
 SendRegularPacket (Ptr<Socket> socket)
 {
-  std::ostringstream data; data << "RP|Hello" << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::REGULAR);
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
   socket->Send (packet);
   NS_LOG_INFO(socket << "Send a regular message");
 }
@@ -400,10 +424,11 @@ SendRegularPacket (Ptr<Socket> socket)
 void
 SendRegularPacket2 (Ptr<Socket> socket, int head, uint32_t member) //from center to members
 {
-  std::ostringstream data; data << "RP|Hello" << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::REGULAR);
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
   socket->Send (packet);
   cout<< socket << "Send a regular message:";
   packet ->Print (cout);
@@ -422,7 +447,7 @@ RoutingHelper::SetupRoutingMessages (NodeContainer & c,
 
   for (int j =0; j< group_size; j++)
   {
-    node_ID_to_index.insert(make_pair(node_list[j],j));
+    m_crsContext->node_ID_to_index.Insert(node_list[j],j);
   }
 
   int i = 10; 
@@ -437,10 +462,18 @@ RoutingHelper::SetupRoutingMessages (NodeContainer & c,
   for (int node_j = 0 ;node_j < group_size; node_j++)
   {
      auto begin = chrono::high_resolution_clock::now();
-     mask_obser.push_back (Masking (vehicle_obser[node_j], node_j));//head
+     m_crsContext->mask_obser.push_back (Masking (vehicle_obser[node_j], node_j));//head
      auto end = chrono::high_resolution_clock::now();
      stat_masking_time[node_j] = stat_masking_time[node_j]+chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
   }
+  if (fixed_beta_bits > 0 && !m_crsContext->QuantizeMasks (fixed_point_width))
+  {
+    NS_FATAL_ERROR ("The masked values cannot be quantized to " << fixed_point_width << " bits");
+  }
+  if (gf_coding && !m_crsContext->SizeField ())
+  {
+    NS_FATAL_ERROR ("The masked values do not fit 53 bits, use fewer --maskBits");
+  }
 
 
   cout<< "LOG: send out the messages from all nodes:" <<endl;
@@ -493,17 +526,19 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
   while ((packet = socket->RecvFrom (srcAddress))) // Rui: receive packet, this is the one already removed all the header by other layers
     {
       Time receive_time = Simulator::Now ();//Rui: Receive time
-      Ptr<Packet> pkt_nc = packet->Copy();
-      uint8_t *buffer = new uint8_t[pkt_nc->GetSize ()];
-      uint16_t size = pkt_nc->CopyData(buffer, pkt_nc->GetSize ());
-      string s = string(buffer, buffer+pkt_nc->GetSize());
+      uint32_t size = packet->GetSize ();
+      CodedPacketHeader crsHeader;
+      packet->PeekHeader (crsHeader);
 
       //Rui: for regular messages
-      vector<string> ss = split(s, "|");
-      if (ss[0]=="RP")
+      if (!crsHeader.IsValid ())
+      {
+        NS_LOG_DEBUG ("Drop a packet with an unknown payload format");
+      }
+      else if (crsHeader.GetType () == CodedPacketHeader::REGULAR)
       {
         cout << "REGULAR" << PrintReceivedRoutingPacket (socket, srcAddress, receive_list)<< endl;
-        cout << s << endl;
+        cout << crsHeader << endl;
       }
       else
       {
@@ -512,12 +547,12 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
             NS_LOG_INFO (m_protocolName + " " + PrintReceivedRoutingPacket (socket, srcAddress, receive_list));
           }
 
-        NS_LOG_INFO("CenterReceive: the containt of the received packet: " << size << "(size) " << s );
+        NS_LOG_INFO("CenterReceive: the containt of the received packet: " << size << "(size) " << crsHeader );
 
-        receive_content.push_back (s);//Rui: add the content
+        receive_content.push_back (crsHeader);//Rui: add the content
 
         InetSocketAddress source_addr = InetSocketAddress::ConvertFrom (srcAddress);
-        int source_id = address_to_id.at(source_addr.GetIpv4 ());
+        int source_id = m_crsContext->address_to_id.At(source_addr.GetIpv4 ().Get ());
 
         TimestampTag timestamp;
         if (packet->FindFirstMatchingByteTag (timestamp)) {
@@ -525,12 +560,19 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
           Time e2e_delay = receive_time - tx;
           NS_LOG_INFO("End to End Delay: " << e2e_delay);
           end_to_end_delay.insert ({source_id, e2e_delay});
+          m_first_send = Min (m_first_send, tx);
         }
         
         auto begin = chrono::high_resolution_clock::now();
-        m_data_mangement_helper.MessageHandle(s, source_id);
+        int source_index = m_crsContext->node_ID_to_index.At(source_id); //the functions of the head are indexed like the bitmap
+        m_data_mangement_helper.MessageHandle(crsHeader, source_index);
         auto end = chrono::high_resolution_clock::now();
         AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
+        if (m_time_to_recover.IsNegative () && m_data_mangement_helper.IsRecoveryComplete ())
+          {
+            m_time_to_recover = receive_time - m_first_send;
+            cout << "[Statistic] All members known at the head after " << m_time_to_recover.GetSeconds () << "s" << endl;
+          }
       }
   
     }
@@ -543,7 +585,7 @@ RoutingHelper::GetReceiveList ()
   return receive_list;
 }
 
-list<string>
+list<CodedPacketHeader>
 RoutingHelper::GetReceiveContent ()
 {
   return receive_content;
@@ -573,6 +615,18 @@ RoutingHelper::GetRecoveryTime()
   return stat_recovery_and_unmasking_time;
 }
 
+Time
+RoutingHelper::GetTimeToRecover()
+{
+  return m_time_to_recover;
+}
+
+Ptr<CrsContext>
+RoutingHelper::GetCrsContext ()
+{
+  return m_crsContext;
+}
+
 void
 RoutingHelper::SetLogging (int log)
 {
@@ -989,9 +1043,10 @@ VanetRoutingExperiment::VanetRoutingExperiment ()
 void
 VanetRoutingExperiment::PrintReceiveList ()
 {
+  const CrsContext &crs = *m_routingHelper->GetCrsContext ();
 
   list<Ipv4Address> mlist = m_routingHelper->GetReceiveList();
-  list<string> mlist_content = m_routingHelper->GetReceiveContent();
+  list<CodedPacketHeader> mlist_content = m_routingHelper->GetReceiveContent();
   
   NS_LOG_INFO("mlist:");
   for (auto const &v : mlist)
@@ -1023,35 +1078,14 @@ VanetRoutingExperiment::PrintReceiveList ()
   int num_of_received = count_if(obser_received.begin(), obser_received.end(), [](int c){return c != -100;});
 
 
-  auto begin = chrono::high_resolution_clock::now();
-  m_routingHelper->m_data_mangement_helper.FunctionsClean();
-  coef = m_routingHelper->m_data_mangement_helper.GetCoef();
-  if (coef.empty())
+  //the head decoded online as the packets arrived, take what it recovered
+  vector<int> recovered = m_routingHelper->m_data_mangement_helper.GetRecoveredSet();
+  if (recovered.size() == num_of_received)
   {
     NS_LOG_LOGIC("no recoverd");
-    auto end = chrono::high_resolution_clock::now();
-    m_routingHelper->AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
-
   }
   else
   {
-    NS_LOG_LOGIC("Functions_Raw after clean: ");
-    for (i = 0; i < coef.size(); i++)
-    {
-        for(j = 0; j < coef[0].size(); j++)
-            NS_LOG_LOGIC(coef[i][j]);
-    }
-    vector<int> map_id = m_routingHelper->m_data_mangement_helper.GetID_Map();
-
-    //m_routingHelper->m_data_recovery_helper();
-    m_routingHelper->m_data_recovery_helper.SetParameters(map_id.size(),coef.size(),coef);
-    m_routingHelper->m_data_recovery_helper.pc();
-
-    auto end = chrono::high_resolution_clock::now();
-    m_routingHelper->AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
-
-    vector<double> cal_result = m_routingHelper->m_data_recovery_helper.GetResults();
-
     cout << "The center received observation values (before recovery): " << endl;
     for (i=0; i<obser_received.size(); i++)
     {
@@ -1059,9 +1093,9 @@ VanetRoutingExperiment::PrintReceiveList ()
     }
     cout << endl;
 
-    for (i = 0; i < cal_result.size(); i++)
+    for (i = 0; i < recovered.size(); i++)
     {
-        obser_received[map_id[i]] = cal_result[i]; //add the calculated result to the observation list
+      obser_received[recovered[i]] = m_routingHelper->m_data_mangement_helper.GetRecoveredValues(recovered[i])[0]; //add the calculated result to the observation list
     }
 
 
@@ -1083,14 +1117,14 @@ VanetRoutingExperiment::PrintReceiveList ()
   }
 
   NS_LOG_LOGIC("The masked value: " );
-  for (i=0; i<mask_obser.size(); i++)
+  for (i=0; i<crs.mask_obser.size(); i++)
   {
-      NS_LOG_LOGIC(mask_obser[i]); 
+      NS_LOG_LOGIC(crs.mask_obser[i]); 
   }
 
 
   
-  double head_mask = mask_obser[0];
+  double head_mask = crs.mask_obser[0];
   NS_LOG_LOGIC("Masked value of head: " << head_mask);
   int num_of_received_2 = count_if(obser_received.begin(), obser_received.end(), [](int c){return c != -100;});
   double aveage_value = (sum_of_all+head_mask)/(num_of_received_2+1);
@@ -1134,13 +1168,28 @@ VanetRoutingExperiment::PrintReceiveList ()
 
   cout << "[Statistic] Handle time (network coding) for each router:" << endl << endl;
   double average_handle = 0.0;
-  for (auto const &v : stat_network_coding_time)
+  for (auto const &v : crs.stat_network_coding_time)
   {
     cout << "Node "<< v.first << "Time(ns) "<< v.second<< "   ";
     average_handle = average_handle + v.second;
   }
   cout << endl;
-  cout << "Average(ms): "<< (average_handle/stat_network_coding_time.size())/1000000.0 << endl << endl;
+  cout << "Average(ms): "<< (average_handle/crs.stat_network_coding_time.size())/1000000.0 << endl << endl;
+
+  cout << "[Statistic] Frames emitted by each router:" << endl << endl;
+  double average_frames = 0.0;
+  for (auto const &v : crs.stat_relay_frames)
+  {
+    cout << "Node "<< v.first << "Frames "<< v.second<< "   ";
+    average_frames = average_frames + v.second;
+  }
+  cout << endl;
+  if (!crs.stat_relay_frames.empty())
+    average_frames = average_frames/crs.stat_relay_frames.size();
+  cout << "Average: "<< average_frames << endl << endl;
+
+  double time_to_recover = m_routingHelper->GetTimeToRecover().GetSeconds();
+  cout << "[Statistic] Time to recover all members (s): " << time_to_recover << endl;
 
   map<int, int> masking_time = m_routingHelper->GetMaskingTime();
   double average_masking = 0.0;
@@ -1160,7 +1209,7 @@ VanetRoutingExperiment::PrintReceiveList ()
   // Rui: print out to files for charts, tables and figures.
   myfile << num_of_received_2 << "," << aveage_value << "," << packet_loss_rate << "," << packet_loss_rate_after_recovery  
   << "," << packet_recovery_rate << "," << 1000.0*average_end_to_end_delay/end_delay.size() << "," <<  (average_masking/masking_time.size())/1000000.0 
-  << "," << (average_handle/stat_network_coding_time.size())/1000000.0 << "," << recovery_time/1000000.0 << "\n";
+  << "," << (average_handle/crs.stat_network_coding_time.size())/1000000.0 << "," << recovery_time/1000000.0 << "," << average_frames << "," << time_to_recover << "\n";
   myfile.close();
 
 
@@ -1485,10 +1534,12 @@ VanetRoutingExperiment::SetupAdhocMobilityNodes ()
                                      "DeltaY", DoubleValue (3.7),
                                      "GridWidth", UintegerValue (2),
                                      "LayoutType", StringValue ("ColumnFirst"));
+      std::stringstream ssSpeed;
+      ssSpeed << "ns3::NormalRandomVariable[Mean=" << speed_mean << "|Variance=" << speed_variance << "|Bound=5.55]";
       mobilityAdhoc.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
                                  "Mode", StringValue ("Time"),
                                  "Time", StringValue ("30s"),
-                                 "Speed", StringValue ("ns3::NormalRandomVariable[Mean=22.22|Variance=0.07716|Bound=5.55]"),
+                                 "Speed", StringValue (ssSpeed.str ()),
                                  "Direction", StringValue ("ns3::ConstantRandomVariable[Constant=0]"),
                                  "Bounds", RectangleValue (Rectangle (0.0, 1000.0, 0.0, 20.0)));
       mobilityAdhoc.Install (m_adhocTxNodes);
@@ -1744,7 +1795,15 @@ main (int argc, char *argv[])
   SeedManager::SetSeed (m_seed);
   cout<<"Seed:"<<m_seed<<endl;*/
 
-  
+
+  ClusterConfig cluster;
+  CommandLine cmd;
+  cmd.AddValue ("speedMean", "mean speed (m/s) of the vehicles", speed_mean);
+  cmd.AddValue ("speedVariance", "variance of the speed of the vehicles", speed_variance);
+  cluster.AddCommandLineValues (cmd);
+  cmd.Parse (argc, argv);
+  cluster.Apply ();
+
   VanetRoutingExperiment experiment;
   experiment.Simulate (argc, argv);
   experiment.PrintReceiveList();
@@ -26,17 +26,18 @@
 #include <string> 
 #include "ns3/rui-vehicle-beta.h"
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-coded-packet.h"
+#include "ns3/rui-cluster-config.h"
+#include "ns3/rui-crs-context.h"
 
 
 using namespace ns3;
 using namespace dsr;
 using namespace std;
 
-extern map<Ipv4Address, int> address_to_id; //Rui: to map IP adress with user ID
-extern vector<double> mask_obser; //Rui: To simulate the observation value/machine learning result for all users
+static double speed_mean = 22.22; //Rui: --speedMean, mean speed (m/s) of mobility model 5
+static double speed_variance = 0.07716; //Rui: --speedVariance, the std variable of the paper squared
 //vector<string> mask_obser_string;
-extern vector<vector<double>> mask_obser_instance;
-extern map<int, int> node_ID_to_index;
 
 NS_LOG_COMPONENT_DEFINE ("vanet-routing-rui-instance");
 
@@ -103,7 +104,7 @@ public:
 
   list<Ipv4Address> GetReceiveList (); //Rui: received from which members
 
-  list<string> GetReceiveContent (); //Rui: the received values, to calculate the avearage 
+  list<CodedPacketHeader> GetReceiveContent (); //Rui: the received values, to calculate the avearage 
 
   map<int, Time> GetEndDelay (); //Rui: for statistic: end-to-end delay
 
@@ -112,6 +113,8 @@ public:
   void AddRecoveryTime(int time_duration); //Rui: for statistic: recovery time
 
   int GetRecoveryTime();//Rui: for statistic: recovery time
+  Time GetTimeToRecover();//Rui: for statistic: first send to all members known at the head, negative if never
+  Ptr<CrsContext> GetCrsContext ();//Rui: the CRS state of this simulation, with the statistics of the routers
 
 
 
@@ -171,10 +174,13 @@ private:
   std::string m_protocolName; ///< protocol name
   int m_log; ///< log
   list<Ipv4Address> receive_list; 
-  list<string> receive_content; 
+  list<CodedPacketHeader> receive_content; 
   map<int, Time> end_to_end_delay; 
   map<int, int> stat_masking_time; 
   int stat_recovery_and_unmasking_time; 
+  Time m_first_send; //Rui: earliest send time among the received packets
+  Time m_time_to_recover; 
+  Ptr<CrsContext> m_crsContext; //Rui: the CRS state of this simulation, shared with the routers
   
 };
 
@@ -190,7 +196,7 @@ RoutingHelper::GetTypeId (void)
 }
 
 RoutingHelper::RoutingHelper ()
-  : m_data_mangement_helper (group_size-1),
+  : m_data_mangement_helper (group_size-1, vehicle_beta, num_entries),
     m_data_recovery_helper (),
     m_TotalSimTime (300.01),
     m_protocol (0),
@@ -202,7 +208,10 @@ RoutingHelper::RoutingHelper ()
     receive_content (),
     end_to_end_delay (),
     stat_masking_time (),
-    stat_recovery_and_unmasking_time (0)
+    stat_recovery_and_unmasking_time (0),
+    m_first_send (Time::Max ()),
+    m_time_to_recover (Seconds (-1)),
+    m_crsContext (CreateObject<CrsContext> ())
     
 {
 }
@@ -226,6 +235,7 @@ RoutingHelper::Install (NodeContainer & c,
   m_routingTables = routingTables;
 
   SetupRoutingProtocol (c);
+  m_crsContext->Install (c);
   AssignIpAddresses (c, d, i); 
   SetupRoutingMessages (c, i);
 }
@@ -328,32 +338,23 @@ RoutingHelper::AssignIpAddresses (NodeContainer & c, NetDeviceContainer & d,
   for (int i = 0; i < c.GetN(); ++i)
   {
     //Ipv4Address address_ipv4;
-    address_to_id.insert(make_pair(adhocTxInterfaces.GetAddress(i),c.Get(i)->GetId()));//Ipv4Address(d.Get(i)->GetAddress())
+    m_crsContext->address_to_id.Insert(adhocTxInterfaces.GetAddress(i).Get (),c.Get(i)->GetId());//Ipv4Address(d.Get(i)->GetAddress())
   }
 }
 
-//Rui: to mask a data. The masks can be chosen with a more complex method.
+//Rui: to mask a data, with the masks of the coding core (rui-crs-core.h): pairwise
+//masks with --maskKey, else the masks of the paper.
 int
 Masking (int raw_obser, int nodeID)
 {
-
-  NS_LOG_INFO("raw_obser: "<<raw_obser);//cout << raw_obser ;
-  double mask = 0;
-  for (int j=nodeID+1; j<group_size; j++)
-  {
-    mask = ( j + nodeID ) % 10; 
-    raw_obser = raw_obser + mask;
-    //NS_LOG_DEBUG ("+" << mask);
-  }
-  for (int j=0; j<nodeID; j++)
+  NS_LOG_INFO("raw_obser: "<<raw_obser);
+  if (mask_key != 0)
   {
-    mask = ( j + nodeID ) % 10; 
-    raw_obser = raw_obser - mask;
-    //NS_LOG_DEBUG ( "-" << mask);
+    double masked = raw_obser;
+    PairwiseMasker (mask_key, group_size, mask_bits).Mask (nodeID, &masked, 1);
+    return masked;
   }
-  // node_observ = node_observ % 100;
-  //cout << endl;
-  return raw_obser; //masked value
+  return MaskObservation (raw_obser, nodeID, group_size); //masked value
 }
 
 
@@ -361,17 +362,32 @@ void
 RoutingHelper::SendOnePacket (Ptr<Socket> socket)
 {
   int nodeID = socket->GetNode ()->GetId ();
-  std::ostringstream data; data << "IT";
-  for(int i = 0; i<mask_obser_instance[nodeID].size();i++)
-    data << "|" << mask_obser_instance[nodeID][i];
-
-  data << '\0';//instance packet
-
-
-  uint32_t dataSize = data.str().length()+1;
+  int node_index = m_crsContext->node_ID_to_index.At (nodeID); //the node IDs of a cluster file need not be 0..size-1
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::ORIGINAL);
+  crsHeader.SetInstance (true);//instance packet
+  crsHeader.SetFloat32 (float_payload);
+  crsHeader.SetGroupSize (group_size);
+  if (fixed_beta_bits > 0)
+  {
+    const Quantized &quantized = m_crsContext->quantized_obser[node_index];//quantized with the masks
+    crsHeader.SetFixedValues (quantized.scale, quantized.integers);//coded in int64 by the relays
+  }
+  else if (gf_coding)
+  {
+    if (!crsHeader.SetFieldValues (m_crsContext->mask_obser_instance[node_index], 0, m_crsContext->fixed_value_bytes))//coded over GF(2^8) by the relays
+    {
+      NS_FATAL_ERROR ("The masked entries of node " << nodeID << " do not fit the field symbols");
+    }
+  }
+  else
+  {
+    crsHeader.SetValues (m_crsContext->mask_obser_instance[node_index]);
+  }
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
-  NS_LOG_INFO ("DataSize: "<<dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
+  NS_LOG_INFO ("DataSize: "<<packet->GetSize ());
 
   TimestampTag timestamp;
   timestamp.SetTimestamp (Simulator::Now ());
@@ -388,10 +404,11 @@ RoutingHelper::SendOnePacket (Ptr<Socket> socket)
 void
 SendRegularPacket (Ptr<Socket> socket)
 {
-  std::ostringstream data; data << "RP|Hello" << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::REGULAR);
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
   socket->Send (packet);
   NS_LOG_INFO(socket << "Send a regular message");
 }
@@ -399,10 +416,11 @@ SendRegularPacket (Ptr<Socket> socket)
 void
 SendRegularPacket2 (Ptr<Socket> socket, int head, uint32_t member) //from center to members
 {
-  std::ostringstream data; data << "RP|Hello" << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::REGULAR);
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
   socket->Send (packet);
   cout<< socket << "Send a regular message:";
   packet ->Print (cout);
@@ -421,7 +439,7 @@ RoutingHelper::SetupRoutingMessages (NodeContainer & c,
 
   for (int j =0; j< group_size; j++)
   {
-    node_ID_to_index.insert(make_pair(node_list[j],j));
+    m_crsContext->node_ID_to_index.Insert(node_list[j],j);
   }
 
   int i = 10; 
@@ -433,19 +451,48 @@ RoutingHelper::SetupRoutingMessages (NodeContainer & c,
   }
 
   cout << "Maksing process Start" << endl;
+  vector<int> mask_offsets = MaskOffsets (group_size); //the mask of each vehicle, set up once for the cluster
   for (int node_j = 0 ;node_j < group_size; node_j++)
   {
      auto begin = chrono::high_resolution_clock::now();
      vector<double> Obs_ins;
-     for (int entries = 0; entries < num_entries; entries++)
+     if (mask_key != 0)
      {
-      //mask each entry
-      Obs_ins.push_back(Masking (vehicle_obser[node_j], node_j));
+      //a mask per entry, all entries of the streams at once
+      Obs_ins.assign(num_entries, (int) vehicle_obser[node_j]);
+      PairwiseMasker (mask_key, group_size, mask_bits).Mask (node_j, Obs_ins.data (), num_entries);
+     }
+     else
+     {
+      //the masks of the paper, added to all entries in one pass
+      Obs_ins.assign(num_entries, vehicle_obser[node_j]);
+      MaskObservations (Obs_ins.data (), num_entries, mask_offsets[node_j]);
+     }
+     //what the vehicle adds to the packets it codes as a relay, fixed for the round
+     if (!gf_coding && fixed_beta_bits == 0)//the field and fixed-point codings have no real-valued contribution
+     {
+      m_crsContext->relay_contribution_instance.push_back (RelayContribution (vehicle_beta[node_j], Obs_ins));
      }
      auto end = chrono::high_resolution_clock::now();
-     mask_obser_instance.push_back (Obs_ins);
+     m_crsContext->mask_obser_instance.push_back (Obs_ins);
      stat_masking_time[node_j] = stat_masking_time[node_j]+chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
   }
+  if (fixed_beta_bits > 0 && !m_crsContext->QuantizeMasks (fixed_point_width))
+  {
+    NS_FATAL_ERROR ("The masked values cannot be quantized to " << fixed_point_width << " bits");
+  }
+  if (gf_coding && !m_crsContext->SizeField ())
+  {
+    NS_FATAL_ERROR ("The masked values do not fit 53 bits, use fewer --maskBits");
+  }
+  for (uint32_t node_j = 0; gf_coding && node_j < m_crsContext->mask_obser_instance.size (); node_j++)
+  {
+    m_crsContext->relay_field_contribution_instance.push_back (RelayFieldContribution (m_crsContext->mask_obser_instance[node_j], m_crsContext->fixed_value_bytes));
+    if (m_crsContext->relay_field_contribution_instance.back ().empty () && !m_crsContext->mask_obser_instance[node_j].empty ())
+    {
+      NS_FATAL_ERROR ("The masked entries of vehicle " << node_j << " do not fit the field symbols");
+    }
+  }
  
 
   cout<< "LOG: send out the messages from all nodes:" <<endl;
@@ -498,27 +545,29 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
   while ((packet = socket->RecvFrom (srcAddress))) // Rui: receive packet, this is the one already removed all the header by other layers
     {
       Time receive_time = Simulator::Now ();//Rui: Receive time
-      Ptr<Packet> pkt_nc = packet->Copy();
-      uint8_t *buffer = new uint8_t[pkt_nc->GetSize ()];
-      uint16_t size = pkt_nc->CopyData(buffer, pkt_nc->GetSize ());
-      string s = string(buffer, buffer+pkt_nc->GetSize());
+      uint32_t size = packet->GetSize ();
+      CodedPacketHeader crsHeader;
+      packet->PeekHeader (crsHeader);
 
       //Rui: for regular messages
       
-      vector<string> ss = split(s, "|");
-      if (ss[0]=="RP")
+      if (!crsHeader.IsValid ())
+      {
+        NS_LOG_DEBUG ("Drop a packet with an unknown payload format");
+      }
+      else if (crsHeader.GetType () == CodedPacketHeader::REGULAR)
       {
         cout << "REGULAR" << PrintReceivedRoutingPacket (socket, srcAddress, receive_list)<< endl;
-        cout << s << endl;
+        cout << crsHeader << endl;
       }
-      else if (ss[0]=="IT")//instance packet
+      else if (crsHeader.IsInstance ())//instance packet
       {
-        NS_LOG_INFO("CenterReceive: the containt of the received instance packet: " << size << "(size) " << s );
+        NS_LOG_INFO("CenterReceive: the containt of the received instance packet: " << size << "(size) " << crsHeader );
         //cout<<"CenterReceive an instance packet"<<endl;
-        receive_content.push_back (s);//Rui: add the content
+        receive_content.push_back (crsHeader);//Rui: add the content
 
         InetSocketAddress source_addr = InetSocketAddress::ConvertFrom (srcAddress);
-        int source_id = address_to_id.at(source_addr.GetIpv4 ());
+        int source_id = m_crsContext->address_to_id.At(source_addr.GetIpv4 ().Get ());
 
         TimestampTag timestamp;
         if (packet->FindFirstMatchingByteTag (timestamp)) {
@@ -526,13 +575,20 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
           Time e2e_delay = receive_time - tx;
           NS_LOG_INFO("End to End Delay: " << e2e_delay);
           end_to_end_delay.insert ({source_id, e2e_delay});
+          m_first_send = Min (m_first_send, tx);
         }
 
         //then data manage
         auto begin = chrono::high_resolution_clock::now();
-        m_data_mangement_helper.MessageHandleInstance(s, source_id);
+        int source_index = m_crsContext->node_ID_to_index.At(source_id); //the functions of the head are indexed like the bitmap
+        m_data_mangement_helper.MessageHandleInstance(crsHeader, source_index);
         auto end = chrono::high_resolution_clock::now();
         AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
+        if (m_time_to_recover.IsNegative () && m_data_mangement_helper.IsRecoveryComplete ())
+          {
+            m_time_to_recover = receive_time - m_first_send;
+            cout << "[Statistic] All members known at the head after " << m_time_to_recover.GetSeconds () << "s" << endl;
+          }
         //cout<<"Time_receive_handle:"<<chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count()<<endl;
       }
       else
@@ -542,12 +598,12 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
             NS_LOG_INFO (m_protocolName + " " + PrintReceivedRoutingPacket (socket, srcAddress, receive_list));
           }
 
-        NS_LOG_INFO("CenterReceive: the containt of the received packet: " << size << "(size) " << s );
+        NS_LOG_INFO("CenterReceive: the containt of the received packet: " << size << "(size) " << crsHeader );
 
-        receive_content.push_back (s);//Rui: add the content
+        receive_content.push_back (crsHeader);//Rui: add the content
 
         InetSocketAddress source_addr = InetSocketAddress::ConvertFrom (srcAddress);
-        int source_id = address_to_id.at(source_addr.GetIpv4 ());
+        int source_id = m_crsContext->address_to_id.At(source_addr.GetIpv4 ().Get ());
 
         TimestampTag timestamp;
         if (packet->FindFirstMatchingByteTag (timestamp)) {
@@ -555,12 +611,19 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
           Time e2e_delay = receive_time - tx;
           NS_LOG_INFO("End to End Delay: " << e2e_delay);
           end_to_end_delay.insert ({source_id, e2e_delay});
+          m_first_send = Min (m_first_send, tx);
         }
         
         auto begin = chrono::high_resolution_clock::now();
-        m_data_mangement_helper.MessageHandle(s, source_id);
+        int source_index = m_crsContext->node_ID_to_index.At(source_id); //the functions of the head are indexed like the bitmap
+        m_data_mangement_helper.MessageHandle(crsHeader, source_index);
         auto end = chrono::high_resolution_clock::now();
         AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
+        if (m_time_to_recover.IsNegative () && m_data_mangement_helper.IsRecoveryComplete ())
+          {
+            m_time_to_recover = receive_time - m_first_send;
+            cout << "[Statistic] All members known at the head after " << m_time_to_recover.GetSeconds () << "s" << endl;
+          }
       }
   
     }
@@ -573,7 +636,7 @@ RoutingHelper::GetReceiveList ()
   return receive_list;
 }
 
-list<string>
+list<CodedPacketHeader>
 RoutingHelper::GetReceiveContent ()
 {
   return receive_content;
@@ -603,6 +666,18 @@ RoutingHelper::GetRecoveryTime()
   return stat_recovery_and_unmasking_time;
 }
 
+Time
+RoutingHelper::GetTimeToRecover()
+{
+  return m_time_to_recover;
+}
+
+Ptr<CrsContext>
+RoutingHelper::GetCrsContext ()
+{
+  return m_crsContext;
+}
+
 void
 RoutingHelper::SetLogging (int log)
 {
@@ -1019,9 +1094,10 @@ VanetRoutingExperiment::VanetRoutingExperiment ()
 void
 VanetRoutingExperiment::PrintReceiveList ()
 {
+  const CrsContext &crs = *m_routingHelper->GetCrsContext ();
 
   list<Ipv4Address> mlist = m_routingHelper->GetReceiveList();
-  list<string> mlist_content = m_routingHelper->GetReceiveContent();
+  list<CodedPacketHeader> mlist_content = m_routingHelper->GetReceiveContent();
   
   /*
   NS_LOG_INFO("mlist:");
@@ -1034,36 +1110,14 @@ VanetRoutingExperiment::PrintReceiveList ()
   cout << "The center receive " << mlist.size() << "packets in total" << "\n";
   
   
-  NS_LOG_INFO("Test here, to FunctionsCleanInstance");
-  m_routingHelper->m_data_mangement_helper.FunctionsCleanInstance();
-  vector<vector<vector<double> >> coef_instance = m_routingHelper->m_data_mangement_helper.GetCoefInstance();
-  vector<vector<int>> map_id = m_routingHelper->m_data_mangement_helper.GetID_Map_Instance();
-
-  auto begin = chrono::high_resolution_clock::now();
-  auto end = chrono::high_resolution_clock::now();
-  if (coef_instance.empty())
+  //the head decoded online as the packets arrived
+  vector<int> recovered = m_routingHelper->m_data_mangement_helper.GetRecoveredSet();
+  cout << "The center knows the instances of vehicles:";
+  for (uint32_t i = 0; i < recovered.size(); i++)
   {
-    NS_LOG_LOGIC("no recoverd");
-    end = chrono::high_resolution_clock::now();
-    m_routingHelper->AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
-
-  }
-  else
-  {
-    //for each entry
-    
-    vector<int> current_map_id;
-    for( int entries = 0; entries < num_entries ; entries++)
-    {
-      current_map_id = map_id[entries];
-      begin = chrono::high_resolution_clock::now();
-      m_routingHelper->m_data_recovery_helper.SetParameters(current_map_id.size(),coef_instance[entries].size(),coef_instance[entries]);
-      m_routingHelper->m_data_recovery_helper.pc();
-      end = chrono::high_resolution_clock::now();
-      m_routingHelper->AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
-    }
-    
+    cout << " " << recovered[i];
   }
+  cout << endl;
 
   std::ofstream myfile; 
   std::ofstream myfile2;
@@ -1104,13 +1158,28 @@ VanetRoutingExperiment::PrintReceiveList ()
 
   cout << "[Statistic] Handle time (network coding) for each router:" << endl << endl;
   double average_handle = 0.0;
-  for (auto const &v : stat_network_coding_time)
+  for (auto const &v : crs.stat_network_coding_time)
   {
     cout << "Node "<< v.first << "Time(ns) "<< v.second<< "   ";
     average_handle = average_handle + v.second;
   }
   cout << endl;
-  cout << "Average(ms): "<< (average_handle/stat_network_coding_time.size())/1000000.0 << endl << endl;
+  cout << "Average(ms): "<< (average_handle/crs.stat_network_coding_time.size())/1000000.0 << endl << endl;
+
+  cout << "[Statistic] Frames emitted by each router:" << endl << endl;
+  double average_frames = 0.0;
+  for (auto const &v : crs.stat_relay_frames)
+  {
+    cout << "Node "<< v.first << "Frames "<< v.second<< "   ";
+    average_frames = average_frames + v.second;
+  }
+  cout << endl;
+  if (!crs.stat_relay_frames.empty())
+    average_frames = average_frames/crs.stat_relay_frames.size();
+  cout << "Average: "<< average_frames << endl << endl;
+
+  double time_to_recover = m_routingHelper->GetTimeToRecover().GetSeconds();
+  cout << "[Statistic] Time to recover all members (s): " << time_to_recover << endl;
 
   map<int, int> masking_time = m_routingHelper->GetMaskingTime();
   double average_masking = 0.0;
@@ -1129,7 +1198,7 @@ VanetRoutingExperiment::PrintReceiveList ()
   
   // Rui: print out to files for charts, tables and figures.
   myfile <<  1000.0*average_end_to_end_delay/legal_dealy << "," <<  (average_masking/masking_time.size())/1000000.0 
-  << "," << (average_handle/stat_network_coding_time.size())/1000000.0 << "," << recovery_time/1000000.0 << "\n";
+  << "," << (average_handle/crs.stat_network_coding_time.size())/1000000.0 << "," << recovery_time/1000000.0 << "," << average_frames << "," << time_to_recover << "\n";
   myfile.close();
 
 
@@ -1454,10 +1523,12 @@ VanetRoutingExperiment::SetupAdhocMobilityNodes ()
                                      "DeltaY", DoubleValue (3.7),
                                      "GridWidth", UintegerValue (2),
                                      "LayoutType", StringValue ("ColumnFirst"));
+      std::stringstream ssSpeed;
+      ssSpeed << "ns3::NormalRandomVariable[Mean=" << speed_mean << "|Variance=" << speed_variance << "|Bound=5.55]";
       mobilityAdhoc.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
                                  "Mode", StringValue ("Time"),
                                  "Time", StringValue ("30000s"),
-                                 "Speed", StringValue ("ns3::NormalRandomVariable[Mean=22.22|Variance=0.07716|Bound=5.55]"),
+                                 "Speed", StringValue (ssSpeed.str ()),
                                  "Direction", StringValue ("ns3::ConstantRandomVariable[Constant=0]"),
                                  "Bounds", RectangleValue (Rectangle (0.0, 1000.0, 0.0, 20.0)));
       mobilityAdhoc.Install (m_adhocTxNodes);
@@ -1715,7 +1786,15 @@ main (int argc, char *argv[])
   SeedManager::SetSeed (m_seed);
   cout<<"Seed:"<<m_seed<<endl;*/
 
-  
+
+  ClusterConfig cluster;
+  CommandLine cmd;
+  cmd.AddValue ("speedMean", "mean speed (m/s) of the vehicles", speed_mean);
+  cmd.AddValue ("speedVariance", "variance of the speed of the vehicles", speed_variance);
+  cluster.AddCommandLineValues (cmd);
+  cmd.Parse (argc, argv);
+  cluster.Apply ();
+
   VanetRoutingExperiment experiment;
   experiment.Simulate (argc, argv);
   experiment.PrintReceiveList();
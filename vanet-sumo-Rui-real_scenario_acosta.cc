@@ -2,11 +2,12 @@
 // We keep some original notes for easy-understanding
 // The m_nNodes variable is set according to the data used. For example, 
 // when there are 1000 vehicles appear in the traffic flow data you choose, then set m_nNodes=1000 
-// You should manually set the node_list[20] and head_node in rui-vehicle-beta.h to locate a cluster you would like to observe. 
+// Set the node IDs (nodes) and the head of the cluster you would like to observe in a cluster file, see rui-cluster-config.h, and pass it with --clusterConfig=<file>. 
 
 
 #include <fstream>
 #include <iostream>
+#include <cmath>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -33,15 +34,18 @@
 #include <map>
 #include "ns3/rui-vehicle-beta.h"
 #include "ns3/rui-equation-cal.h"
+#include "ns3/rui-coded-packet.h"
+#include "ns3/rui-cluster-config.h"
+#include "ns3/rui-crs-context.h"
+#include "ns3/rui-spatial-cluster.h"
+#include "ns3/rui-mobility-trace.h"
 
 
 using namespace ns3;
 using namespace dsr;
 using namespace std;
 
-extern map<Ipv4Address, int> address_to_id; //Rui: to map IP adress with user ID
-extern vector<double> mask_obser; //Rui: To simulate the observation value/machine learning result for all users
-extern map<int, int> node_ID_to_index; //Rui: to map the index of nodes in the mobility node container and routing node container
+static std::string mobility_trace = ""; //Rui: --mobilityTrace, the Acosta trace if empty
 
 
 
@@ -98,7 +102,7 @@ public:
                 int routingTables);
 
   
-  DataManagementHelper m_data_mangement_helper; //Rui: to mange the received data
+  vector<DataManagementHelper> m_data_mangement_helper; //Rui: to mange the received data, one per cluster
   DataRecoveryHelper m_data_recovery_helper; //Rui: to recover the lost packets
 
   /**
@@ -110,7 +114,7 @@ public:
 
   list<Ipv4Address> GetReceiveList (); //Rui: received from which members
 
-  list<string> GetReceiveContent (); //Rui: the received values, to calculate the avearage 
+  list<CodedPacketHeader> GetReceiveContent (); //Rui: the received values, to calculate the avearage 
 
   map<int, Time> GetEndDelay (); //Rui: for statistic: end-to-end delay
 
@@ -119,6 +123,8 @@ public:
   void AddRecoveryTime(int time_duration); //Rui: for statistic: recovery time
 
   int GetRecoveryTime();//Rui: for statistic: recovery time
+  Time GetTimeToRecover(int cluster);//Rui: for statistic: first send to all members known at the head, negative if never
+  Ptr<CrsContext> GetCrsContext ();//Rui: the CRS state of this simulation, with the statistics of the routers
 
 
 
@@ -169,6 +175,14 @@ private:
 
   void SendOnePacket (Ptr<Socket> socket);//Rui: Send out a packet
 
+  /**
+   * \brief Form the clusters from the current vehicle positions, then set up the routing messages
+   * \param c node container, every vehicle
+   * \param adhocTxInterfaces IPv4 interface container
+   * \return none
+   */
+  void FormClusters (NodeContainer c, Ipv4InterfaceContainer adhocTxInterfaces);
+
   double m_TotalSimTime;        ///< seconds
   uint32_t m_protocol;       ///< routing protocol; 0=NONE, 1=OLSR, 2=AODV, 3=DSDV, 4=DSR
   uint32_t m_port;           ///< port
@@ -177,10 +191,13 @@ private:
   std::string m_protocolName; ///< protocol name
   int m_log; ///< log
   list<Ipv4Address> receive_list;
-  list<string> receive_content; 
+  list<CodedPacketHeader> receive_content; 
   map<int, Time> end_to_end_delay; 
   map<int, int> stat_masking_time; 
   int stat_recovery_and_unmasking_time; 
+  vector<Time> m_first_send; //Rui: earliest send time among the received packets of each cluster
+  vector<Time> m_time_to_recover; 
+  Ptr<CrsContext> m_crsContext; //Rui: the CRS state of this simulation, shared with the routers
   
 };
 
@@ -196,7 +213,7 @@ RoutingHelper::GetTypeId (void)
 }
 
 RoutingHelper::RoutingHelper ()
-  : m_data_mangement_helper (group_size-1),
+  : m_data_mangement_helper (cluster_list.size (), DataManagementHelper (group_size-1, vehicle_beta, num_entries)),
     m_data_recovery_helper (),
     m_TotalSimTime (300.01),
     m_protocol (0),
@@ -208,7 +225,10 @@ RoutingHelper::RoutingHelper ()
     receive_content (),
     end_to_end_delay (),
     stat_masking_time (),
-    stat_recovery_and_unmasking_time (0)
+    stat_recovery_and_unmasking_time (0),
+    m_first_send (cluster_list.size (), Time::Max ()),
+    m_time_to_recover (cluster_list.size (), Seconds (-1)),
+    m_crsContext (CreateObject<CrsContext> ())
     
 {
 }
@@ -233,10 +253,53 @@ RoutingHelper::Install (NodeContainer & c,
   //NodeContainer sub_node_contaniner;
 
   SetupRoutingProtocol (c);
+  m_crsContext->Install (c);
   NS_LOG_INFO("Install IP now: ");
   AssignIpAddresses (c, d, i); 
   NS_LOG_INFO("Install RoutingMessages now: ");
-  SetupRoutingMessages (c, i);
+  if (cluster_form_time >= 0)
+  {
+    Simulator::Schedule (Seconds (cluster_form_time), &RoutingHelper::FormClusters, this, c, i);
+  }
+  else
+  {
+    SetupRoutingMessages (c, i);
+  }
+}
+
+void
+RoutingHelper::FormClusters (NodeContainer c, Ipv4InterfaceContainer adhocTxInterfaces)
+{
+  vector<int> ids;
+  vector<double> x;
+  vector<double> y;
+  for (uint32_t n = 0; n < c.GetN (); n++)
+  {
+    Vector position = c.Get (n)->GetObject<MobilityModel> ()->GetPosition ();
+    ids.push_back (c.Get (n)->GetId ());
+    x.push_back (position.x);
+    y.push_back (position.y);
+  }
+  cluster_list = FormSpatialClusters (ids, x, y, cluster_range, group_size, head_node, cluster_max_hops, cluster_max_count);
+  cout << "t = " << Simulator::Now ().GetSeconds () << " formed " << cluster_list.size () << " cluster(s) of " << group_size << " vehicles" << endl;
+  for (uint32_t k = 0; k < cluster_list.size (); k++)
+  {
+    cout << "Cluster " << k << ", head node " << cluster_list[k][head_node] << ":";
+    for (int node : cluster_list[k])
+    {
+      cout << " " << node;
+    }
+    cout << endl;
+  }
+  if (cluster_list.empty ())
+  {
+    return;
+  }
+  node_list = cluster_list[0];
+  m_data_mangement_helper.assign (cluster_list.size (), DataManagementHelper (group_size-1, vehicle_beta, num_entries));
+  m_first_send.assign (cluster_list.size (), Time::Max ());
+  m_time_to_recover.assign (cluster_list.size (), Seconds (-1));
+  SetupRoutingMessages (c, adhocTxInterfaces);
 }
 
 //Sets up a routing packet for tranmission
@@ -346,33 +409,24 @@ RoutingHelper::AssignIpAddresses (NodeContainer & c, NetDeviceContainer & d,
   for (int i = 0; i < c.GetN(); ++i)
   {
     //Ipv4Address address_ipv4;
-    address_to_id.insert(make_pair(adhocTxInterfaces.GetAddress(i),c.Get(i)->GetId()));//Ipv4Address(d.Get(i)->GetAddress())
+    m_crsContext->address_to_id.Insert(adhocTxInterfaces.GetAddress(i).Get (),c.Get(i)->GetId());//Ipv4Address(d.Get(i)->GetAddress())
   }
   NS_LOG_UNCOND ("Finish IP add mapping.");
 }
 
-//Rui: to mask a data. The masks can be chosen with a more complex method.
+//Rui: to mask a data, with the masks of the coding core (rui-crs-core.h): pairwise
+//masks with --maskKey, else the masks of the paper.
 int
 Masking (int raw_obser, int nodeID)
 {
-
-  NS_LOG_INFO("raw_obser: "<<raw_obser);//cout << raw_obser ;
-  double mask = 0;
-  for (int j=nodeID+1; j<group_size; j++)
-  {
-    mask = ( j + nodeID ) % 10; 
-    raw_obser = raw_obser + mask;
-    //NS_LOG_DEBUG ("+" << mask);
-  }
-  for (int j=0; j<nodeID; j++)
+  NS_LOG_INFO("raw_obser: "<<raw_obser);
+  if (mask_key != 0)
   {
-    mask = ( j + nodeID ) % 10; 
-    raw_obser = raw_obser - mask;
-    //NS_LOG_DEBUG ( "-" << mask);
+    double masked = raw_obser;
+    PairwiseMasker (mask_key, group_size, mask_bits).Mask (nodeID, &masked, 1);
+    return masked;
   }
-  // node_observ = node_observ % 100;
-  //cout << endl;
-  return raw_obser; //masked value
+  return MaskObservation (raw_obser, nodeID, group_size); //masked value
 }
 
 
@@ -380,14 +434,34 @@ void
 RoutingHelper::SendOnePacket (Ptr<Socket> socket)
 {
   int nodeID = socket->GetNode ()->GetId ();
-  int node_index = node_ID_to_index.at(nodeID); 
+  int node_index = m_crsContext->node_ID_to_index.At(nodeID); 
   int node_observ = vehicle_obser[node_index]; //observation value
 
 
-  std::ostringstream data; data << node_observ << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::ORIGINAL);
+  crsHeader.SetFloat32 (float_payload);
+  crsHeader.SetGroupSize (group_size);
+  if (fixed_beta_bits > 0)
+  {
+    //at the scale of the masked value the vehicle adds as a relay, so the head sees one scale per vehicle
+    int8_t scale = m_crsContext->quantized_obser[node_index].scale;
+    crsHeader.SetFixedValues (scale, vector<int64_t> (1, llround (ldexp (node_observ, -scale))));//coded in int64 by the relays
+  }
+  else if (gf_coding)
+  {
+    if (!crsHeader.SetFieldValues (vector<double> (1, node_observ), 0, m_crsContext->fixed_value_bytes))//coded over GF(2^8) by the relays
+    {
+      NS_FATAL_ERROR ("The observation " << node_observ << " does not fit the field symbols");
+    }
+  }
+  else
+  {
+    crsHeader.SetValues (vector<double> (1, node_observ));
+  }
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
 
   TimestampTag timestamp;
   timestamp.SetTimestamp (Simulator::Now ());
@@ -403,10 +477,11 @@ RoutingHelper::SendOnePacket (Ptr<Socket> socket)
 void
 SendRegularPacket (Ptr<Socket> socket)
 {
-  std::ostringstream data; data << "RP|Hello" << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::REGULAR);
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
   socket->Send (packet);
   //NS_LOG_ISend a messageNFO(socket << "Send a regular message");
 }
@@ -414,10 +489,11 @@ SendRegularPacket (Ptr<Socket> socket)
 void
 SendRegularPacket2 (Ptr<Socket> socket, int head, uint32_t member) //from center to members
 {
-  std::ostringstream data; data << "RP|Hello" << '\0';
-  uint32_t dataSize = data.str().length()+1;
+  CodedPacketHeader crsHeader;
+  crsHeader.SetType (CodedPacketHeader::REGULAR);
 
-  Ptr<Packet> packet = Create<Packet> ((uint8_t*) data.str().c_str(), dataSize);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (crsHeader);
   socket->Send (packet);
   cout<< socket << "Send a regular message:";
   packet ->Print (cout);
@@ -432,51 +508,70 @@ RoutingHelper::SetupRoutingMessages (NodeContainer & c,
 
   m_nSinks = 1; //Rui: only 0 is the sink
   
-  for (int j =0; j< group_size; j++)
+  map<int, uint32_t> node_ID_to_container; //position of each node in c, see SetupRoutingNodesFromMobNodes
+  for (uint32_t n = 0; n < c.GetN(); n++)
   {
-    node_ID_to_index.insert(make_pair(node_list[j],j));
+    node_ID_to_container.insert(make_pair(c.Get(n)->GetId(),n));
   }
-  int i = head_node; 
-   
-  
-  int index_head = node_ID_to_index.at(i);
-  if (m_protocol != 0)
+  for (int k = 0; k < cluster_list.size(); k++)
   {
-    Ptr<Socket> sink = SetupRoutingPacketReceive (adhocTxInterfaces.GetAddress (index_head), c.Get (index_head));
+    for (int j =0; j< group_size; j++)
+    {
+      m_crsContext->node_ID_to_index.Insert(cluster_list[k][j],j);
+      m_crsContext->node_ID_to_cluster.Insert(cluster_list[k][j],k);
+    }
   }
 
   cout << "Maksing process Start" << endl;
+  //the masks of an index are the same in every cluster
   for (int node_j = 0 ;node_j < group_size; node_j++)
   {
      auto begin = chrono::high_resolution_clock::now();
-     mask_obser.push_back (Masking (vehicle_obser[node_j], node_j));//head
+     m_crsContext->mask_obser.push_back (Masking (vehicle_obser[node_j], node_j));//head
      auto end = chrono::high_resolution_clock::now();
      stat_masking_time[node_j] = stat_masking_time[node_j]+chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
   }
+  if (fixed_beta_bits > 0 && !m_crsContext->QuantizeMasks (fixed_point_width))
+  {
+    NS_FATAL_ERROR ("The masked values cannot be quantized to " << fixed_point_width << " bits");
+  }
+  if (gf_coding && !m_crsContext->SizeField ())
+  {
+    NS_FATAL_ERROR ("The masked values do not fit 53 bits, use fewer --maskBits");
+  }
  
 
   cout<< "LOG: send out the messages from all nodes:" <<endl;
   
-  double schedule_clock = 15; 
-  double schedule_clock_text_arp = 10; 
-
-  for (uint32_t senderNode = 0; senderNode < group_size; senderNode ++) //RuiTest
+  for (int k = 0; k < cluster_list.size(); k++) //the clusters run at the same time
   {
-    //senderNode = node_list[node_index];
-    if (senderNode != index_head) //not the receiver
+    int index_head = node_ID_to_container.at(cluster_list[k][head_node]); 
+    if (m_protocol != 0)
     {
-
-      TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
-      Ptr<Socket> source = Socket::CreateSocket (c.Get (senderNode), tid);
-      source->Bind(InetSocketAddress (adhocTxInterfaces.GetAddress (senderNode), m_port));
-      source->Connect(InetSocketAddress (adhocTxInterfaces.GetAddress (index_head), m_port));
-      Simulator::Schedule(Seconds(schedule_clock_text_arp), &SendRegularPacket, source); 
-      void (RoutingHelper::*fp)(Ptr<Socket> socket) = &RoutingHelper::SendOnePacket;
-      Simulator::Schedule(Seconds(schedule_clock), fp, this, source);
-      schedule_clock=schedule_clock+0.1;
-      schedule_clock_text_arp=schedule_clock_text_arp+0.15;
+      Ptr<Socket> sink = SetupRoutingPacketReceive (adhocTxInterfaces.GetAddress (index_head), c.Get (index_head));
     }
-  }  
+
+    double schedule_clock = 15; 
+    double schedule_clock_text_arp = 10; 
+
+    for (int member = 0; member < group_size; member ++) //RuiTest
+    {
+      uint32_t senderNode = node_ID_to_container.at(cluster_list[k][member]);
+      if (senderNode != index_head) //not the receiver
+      {
+
+        TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+        Ptr<Socket> source = Socket::CreateSocket (c.Get (senderNode), tid);
+        source->Bind(InetSocketAddress (adhocTxInterfaces.GetAddress (senderNode), m_port));
+        source->Connect(InetSocketAddress (adhocTxInterfaces.GetAddress (index_head), m_port));
+        Simulator::Schedule(Seconds(schedule_clock_text_arp), &SendRegularPacket, source); 
+        void (RoutingHelper::*fp)(Ptr<Socket> socket) = &RoutingHelper::SendOnePacket;
+        Simulator::Schedule(Seconds(schedule_clock), fp, this, source);
+        schedule_clock=schedule_clock+0.1;
+        schedule_clock_text_arp=schedule_clock_text_arp+0.15;
+      }
+    }  
+  }
 }
 
 static std::string PrintReceivedRoutingPacket (Ptr<Socket> socket, Address srcAddress, list<Ipv4Address>& receive_list)
@@ -507,17 +602,19 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
   while ((packet = socket->RecvFrom (srcAddress))) // Rui: receive packet, this is the one already removed all the header by other layers
     {
       Time receive_time = Simulator::Now ();//Rui: Receive time
-      Ptr<Packet> pkt_nc = packet->Copy();
-      uint8_t *buffer = new uint8_t[pkt_nc->GetSize ()];
-      uint16_t size = pkt_nc->CopyData(buffer, pkt_nc->GetSize ());
-      string s = string(buffer, buffer+pkt_nc->GetSize());
+      uint32_t size = packet->GetSize ();
+      CodedPacketHeader crsHeader;
+      packet->PeekHeader (crsHeader);
 
       //Rui: for regular messages
-      vector<string> ss = split(s, "|");
-      if (ss[0]=="RP")
+      if (!crsHeader.IsValid ())
+      {
+        NS_LOG_DEBUG ("Drop a packet with an unknown payload format");
+      }
+      else if (crsHeader.GetType () == CodedPacketHeader::REGULAR)
       {
         cout << "REGULAR" << PrintReceivedRoutingPacket (socket, srcAddress, receive_list)<< endl;
-        cout << s << endl;
+        cout << crsHeader << endl;
       }
       else
       {
@@ -526,11 +623,17 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
             NS_LOG_INFO (m_protocolName + " " + PrintReceivedRoutingPacket (socket, srcAddress, receive_list));
           }
 
-        NS_LOG_INFO("CenterReceive: the containt of the received packet: " << size << "(size) " << s );
-        receive_content.push_back (s);//Rui: add the content
+        NS_LOG_INFO("CenterReceive: the containt of the received packet: " << size << "(size) " << crsHeader );
+        receive_content.push_back (crsHeader);//Rui: add the content
 
         InetSocketAddress source_addr = InetSocketAddress::ConvertFrom (srcAddress);
-        int source_id = address_to_id.at(source_addr.GetIpv4 ());
+        int source_id = m_crsContext->address_to_id.At(source_addr.GetIpv4 ().Get ());
+        int cluster = m_crsContext->node_ID_to_cluster.At(socket->GetNode ()->GetId ());
+        if (m_crsContext->node_ID_to_cluster.At(source_id) != cluster)
+          {
+            NS_LOG_DEBUG ("Drop a packet from node " << source_id << " of another cluster");
+            continue;
+          }
 
         TimestampTag timestamp;
         if (packet->FindFirstMatchingByteTag (timestamp)) {
@@ -540,15 +643,21 @@ RoutingHelper::ReceiveRoutingPacket (Ptr<Socket> socket)
           NS_LOG_INFO("Receive time: " << receive_time);
           NS_LOG_INFO("End to End Delay: " << e2e_delay);
           end_to_end_delay.insert ({source_id, e2e_delay});
+          m_first_send[cluster] = Min (m_first_send[cluster], tx);
         }
         
         auto begin = chrono::high_resolution_clock::now();
 
-        int source_index = node_ID_to_index.at(source_id);
-        m_data_mangement_helper.MessageHandle(s, source_index);
+        int source_index = m_crsContext->node_ID_to_index.At(source_id);
+        m_data_mangement_helper[cluster].MessageHandle(crsHeader, source_index);
 
         auto end = chrono::high_resolution_clock::now();
         AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
+        if (m_time_to_recover[cluster].IsNegative () && m_data_mangement_helper[cluster].IsRecoveryComplete ())
+          {
+            m_time_to_recover[cluster] = receive_time - m_first_send[cluster];
+            cout << "[Statistic] All members of cluster " << cluster << " known at the head after " << m_time_to_recover[cluster].GetSeconds () << "s" << endl;
+          }
       }
   
     }
@@ -561,7 +670,7 @@ RoutingHelper::GetReceiveList ()
   return receive_list;
 }
 
-list<string>
+list<CodedPacketHeader>
 RoutingHelper::GetReceiveContent ()
 {
   return receive_content;
@@ -591,6 +700,18 @@ RoutingHelper::GetRecoveryTime()
   return stat_recovery_and_unmasking_time;
 }
 
+Time
+RoutingHelper::GetTimeToRecover(int cluster)
+{
+  return m_time_to_recover[cluster];
+}
+
+Ptr<CrsContext>
+RoutingHelper::GetCrsContext ()
+{
+  return m_crsContext;
+}
+
 void
 RoutingHelper::SetLogging (int log)
 {
@@ -1033,10 +1154,16 @@ VanetRoutingExperiment::VanetRoutingExperiment ()
 void
 VanetRoutingExperiment::PrintReceiveList ()
 {
+  const CrsContext &crs = *m_routingHelper->GetCrsContext ();
 
   NS_LOG_INFO("Finish: experiment. Start: statistic + summary.");
+  if (cluster_list.empty ())
+  {
+    cout << "[Statistic] No cluster was formed, try a larger --clusterRange or --clusterMaxHops" << endl;
+    return;
+  }
   list<Ipv4Address> mlist = m_routingHelper->GetReceiveList();
-  list<string> mlist_content = m_routingHelper->GetReceiveContent();
+  list<CodedPacketHeader> mlist_content = m_routingHelper->GetReceiveContent();
   
   NS_LOG_INFO("mlist:");
   for (auto const &v : mlist)
@@ -1047,98 +1174,154 @@ VanetRoutingExperiment::PrintReceiveList ()
   cout << "The center receive " << mlist.size() << "packets in total" << "\n";
   
 
-  vector<vector<double> > coef = m_routingHelper->m_data_mangement_helper.GetCoef();
-  int i,j;
-  
+  std::ofstream clusterfile;
+  clusterfile.open ("rui_statistic_clusters.csv",std::ios::app);
+  /*clusterfile << "cluster, head node, Received number before recovery, Received number after recovery, Average local gradient,
+  packet_loss_rate, packet_loss_rate_after_recovery, packet_recovery_rate, end_to_end_delay(average), time to recover all members\n";*/
 
-  NS_LOG_LOGIC("Functions_Raw");
-  for (i = 0; i < coef.size(); i++)
+  map<int, Time> end_delay = m_routingHelper->GetEndDelay();
+  int i,j;
+  int total_received = 0;
+  int total_received_2 = 0;
+  int total_recovered_clusters = 0;
+  double total_average_value = 0.0;
+  double time_to_recover = 0.0;
+  for (int k = 0; k < cluster_list.size(); k++)
   {
-      for(j = 0; j < coef[0].size(); j++)
-          NS_LOG_LOGIC(coef[i][j]);
-  }
+    cout << "[Statistic] Cluster " << k << ", head node " << cluster_list[k][head_node] << ":" << endl;
+    DataManagementHelper &data_mangement_helper = m_routingHelper->m_data_mangement_helper[k];
+    vector<vector<double> > coef = data_mangement_helper.GetCoef();
 
-  NS_LOG_LOGIC("The center received observation values (before recovery): ");
-  vector<double> obser_received = m_routingHelper->m_data_mangement_helper.GetObserList();
-  for (i=0; i<obser_received.size(); i++)
-  {
-      NS_LOG_LOGIC(obser_received[i]);
-  }
+    NS_LOG_LOGIC("Functions_Raw");
+    for (i = 0; i < coef.size(); i++)
+    {
+        for(j = 0; j < coef[0].size(); j++)
+            NS_LOG_LOGIC(coef[i][j]);
+    }
 
-  int num_of_received = count_if(obser_received.begin(), obser_received.end(), [](int c){return c != -100;});
+    NS_LOG_LOGIC("The center received observation values (before recovery): ");
+    vector<double> obser_received = data_mangement_helper.GetObserList();
+    for (i=0; i<obser_received.size(); i++)
+    {
+        NS_LOG_LOGIC(obser_received[i]);
+    }
 
+    int num_of_received = count_if(obser_received.begin(), obser_received.end(), [](int c){return c != -100;});
 
-  auto begin = chrono::high_resolution_clock::now();
-  m_routingHelper->m_data_mangement_helper.FunctionsClean();
-  coef = m_routingHelper->m_data_mangement_helper.GetCoef();
-  if (coef.empty())
-  {
-    NS_LOG_LOGIC("no recoverd");
-    auto end = chrono::high_resolution_clock::now();
-    m_routingHelper->AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
 
-  }
-  else
-  {
-    NS_LOG_LOGIC("Functions_Raw after clean: ");
-    for (i = 0; i < coef.size(); i++)
+    //the head decoded online as the packets arrived, take what it recovered
+    vector<int> recovered = data_mangement_helper.GetRecoveredSet();
+    if (recovered.size() == num_of_received)
     {
-        for(j = 0; j < coef[0].size(); j++)
-            NS_LOG_LOGIC(coef[i][j]);
+      NS_LOG_LOGIC("no recoverd");
     }
-    vector<int> map_id = m_routingHelper->m_data_mangement_helper.GetID_Map();
+    else
+    {
+      cout << "The center received observation values (before recovery): " << endl;
+      for (i=0; i<obser_received.size(); i++)
+      {
+          cout << obser_received[i] << " ";
+      }
+      cout << endl;
 
-    //m_routingHelper->m_data_recovery_helper();
-    m_routingHelper->m_data_recovery_helper.SetParameters(map_id.size(),coef.size(),coef);
-    m_routingHelper->m_data_recovery_helper.pc();
+      for (i = 0; i < recovered.size(); i++)
+      {
+        obser_received[recovered[i]] = data_mangement_helper.GetRecoveredValues(recovered[i])[0]; 
+      }
 
-    auto end = chrono::high_resolution_clock::now();
-    m_routingHelper->AddRecoveryTime(chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count());
 
-    vector<double> cal_result = m_routingHelper->m_data_recovery_helper.GetResults();
+      cout << "The center received observation values (after recovery): " << endl;
+      for (i=0; i<obser_received.size(); i++)
+      {
+          cout << obser_received[i] << " ";
+      }
+      cout<<endl;
+    }
+    //unmasking
 
-    cout << "The center received observation values (before recovery): " << endl;
+    double sum_of_all = 0.0;
     for (i=0; i<obser_received.size(); i++)
     {
-        cout << obser_received[i] << " ";
+        if (obser_received[i] != -100)
+          sum_of_all = sum_of_all + obser_received[i];
+        
     }
-    cout << endl;
 
-    for (i = 0; i < cal_result.size(); i++)
+    NS_LOG_LOGIC("The masked value: " );
+    for (i=0; i<crs.mask_obser.size(); i++)
     {
-        obser_received[map_id[i]] = cal_result[i]; 
+        NS_LOG_LOGIC(crs.mask_obser[i]); 
     }
 
+    
+    double head_mask = crs.mask_obser[0];
+    NS_LOG_LOGIC("Masked value of head: " << head_mask);
+    int num_of_received_2 = count_if(obser_received.begin(), obser_received.end(), [](int c){return c != -100;});
+    double aveage_value = (sum_of_all+head_mask)/(num_of_received_2+1);
+    cout << "[Statistic] Received number: "<< num_of_received_2 << "  [Statistic] Average local gradient:" << aveage_value << endl << endl;
+
+    double packet_loss_rate = 1.0 - (double)num_of_received/(group_size-1);
+    cout << "[Statistic] packet_loss_rate: "<< packet_loss_rate << endl;
+    double packet_loss_rate_after_recovery = 1.0 - (double)num_of_received_2/(group_size-1);
+    cout << "[Statistic] packet_loss_rate_after_recovery: "<< packet_loss_rate_after_recovery  << endl << endl;
+    double packet_recovery_rate = 0.0;
+    if (num_of_received != group_size-1)
+    {
+      packet_recovery_rate = (double)(num_of_received_2-num_of_received)/(group_size-1-num_of_received);
+      cout << "[Statistic] packet_recovery_rate: "<< packet_recovery_rate << endl << endl;
+    }
 
-    cout << "The center received observation values (after recovery): " << endl;
-    for (i=0; i<obser_received.size(); i++)
+    double cluster_delay = 0.0;
+    int cluster_legal_delay = 0;
+    for (int node : cluster_list[k])
     {
-        cout << obser_received[i] << " ";
+      auto it = end_delay.find(node);
+      if (it != end_delay.end() && it->second.GetSeconds()<0.10) //remove the ones that too long because of no ARP
+      {
+        cluster_delay = cluster_delay + it->second.GetSeconds();
+        cluster_legal_delay++;
+      }
+    }
+    double cluster_time_to_recover = m_routingHelper->GetTimeToRecover(k).GetSeconds();
+    cout << "[Statistic] Average end_to_end_delay(ms): " << 1000.0*cluster_delay/cluster_legal_delay
+         << "  [Statistic] Time to recover all members (s): " << cluster_time_to_recover << endl << endl;
+
+    clusterfile << k << "," << cluster_list[k][head_node] << "," << num_of_received << "," << num_of_received_2 << "," << aveage_value
+    << "," << packet_loss_rate << "," << packet_loss_rate_after_recovery << "," << packet_recovery_rate
+    << "," << 1000.0*cluster_delay/cluster_legal_delay << "," << cluster_time_to_recover << "\n";
+
+    total_received = total_received + num_of_received;
+    total_received_2 = total_received_2 + num_of_received_2;
+    total_average_value = total_average_value + aveage_value;
+    if (cluster_time_to_recover >= 0)
+    {
+      total_recovered_clusters++;
+      time_to_recover = max(time_to_recover, cluster_time_to_recover);
     }
-    cout<<endl;
   }
-  //unmasking
-
-  double sum_of_all = 0.0;
-  for (i=0; i<obser_received.size(); i++)
+  clusterfile.close();
+
+  //all clusters together
+  int expected = cluster_list.size()*(group_size-1);
+  int num_of_received_2 = total_received_2;
+  double aveage_value = total_average_value/cluster_list.size();
+  double packet_loss_rate = 1.0 - (double)total_received/expected;
+  double packet_loss_rate_after_recovery = 1.0 - (double)total_received_2/expected;
+  double packet_recovery_rate = 0.0;
+  if (total_received != expected)
   {
-      if (obser_received[i] != -100)
-        sum_of_all = sum_of_all + obser_received[i];
-      
+    packet_recovery_rate = (double)(total_received_2-total_received)/(expected-total_received);
   }
-
-  NS_LOG_LOGIC("The masked value: " );
-  for (i=0; i<mask_obser.size(); i++)
+  if (total_recovered_clusters != cluster_list.size())
   {
-      NS_LOG_LOGIC(mask_obser[i]); 
+    time_to_recover = -1; //not every head knows all its members
+  }
+  if (cluster_list.size() > 1)
+  {
+    cout << "[Statistic] All " << cluster_list.size() << " clusters: Received number: " << num_of_received_2
+         << "  packet_loss_rate: " << packet_loss_rate << "  packet_loss_rate_after_recovery: " << packet_loss_rate_after_recovery
+         << "  packet_recovery_rate: " << packet_recovery_rate << "  clusters with all members known: " << total_recovered_clusters << endl << endl;
   }
-
-  
-  double head_mask = mask_obser[0];
-  NS_LOG_LOGIC("Masked value of head: " << head_mask);
-  int num_of_received_2 = count_if(obser_received.begin(), obser_received.end(), [](int c){return c != -100;});
-  double aveage_value = (sum_of_all+head_mask)/(num_of_received_2+1);
-  cout << "[Statistic] Received number: "<< num_of_received_2 << "  [Statistic] Average local gradient:" << aveage_value << endl << endl;
 
   std::ofstream myfile;
   
@@ -1149,19 +1332,6 @@ VanetRoutingExperiment::PrintReceiveList ()
   \n";*/
 
 
-  double packet_loss_rate = 1.0 - (double)num_of_received/(group_size-1);
-  cout << "[Statistic] packet_loss_rate: "<< packet_loss_rate << endl;
-  double packet_loss_rate_after_recovery = 1.0 - (double)num_of_received_2/(group_size-1);
-  cout << "[Statistic] packet_loss_rate_after_recovery: "<< packet_loss_rate_after_recovery  << endl << endl;
-  double packet_recovery_rate = 0.0;
-  if (num_of_received != group_size-1)
-  {
-    packet_recovery_rate = (double)(num_of_received_2-num_of_received)/(group_size-1-num_of_received);
-    cout << "[Statistic] packet_recovery_rate: "<< packet_recovery_rate << endl << endl;
-  }
-
-
-  map<int, Time> end_delay = m_routingHelper->GetEndDelay();
   cout << "[Statistic] end_to_end_delay:" << endl << endl;
   double average_end_to_end_delay = 0.0;
   double average_end_to_end_delay_raw = 0.0;
@@ -1185,13 +1355,27 @@ VanetRoutingExperiment::PrintReceiveList ()
 
   cout << "[Statistic] Handle time (network coding) for each router:" << endl << endl;
   double average_handle = 0.0;
-  for (auto const &v : stat_network_coding_time)
+  for (auto const &v : crs.stat_network_coding_time)
   {
     cout << "Node "<< v.first << "Time(ns) "<< v.second<< "   ";
     average_handle = average_handle + v.second;
   }
   cout << endl;
-  cout << "Average(ms): "<< (average_handle/stat_network_coding_time.size())/1000000.0 << endl << endl;
+  cout << "Average(ms): "<< (average_handle/crs.stat_network_coding_time.size())/1000000.0 << endl << endl;
+
+  cout << "[Statistic] Frames emitted by each router:" << endl << endl;
+  double average_frames = 0.0;
+  for (auto const &v : crs.stat_relay_frames)
+  {
+    cout << "Node "<< v.first << "Frames "<< v.second<< "   ";
+    average_frames = average_frames + v.second;
+  }
+  cout << endl;
+  if (!crs.stat_relay_frames.empty())
+    average_frames = average_frames/crs.stat_relay_frames.size();
+  cout << "Average: "<< average_frames << endl << endl;
+
+  cout << "[Statistic] Time to recover all members (s): " << time_to_recover << endl;
 
   map<int, int> masking_time = m_routingHelper->GetMaskingTime();
   double average_masking = 0.0;
@@ -1211,7 +1395,7 @@ VanetRoutingExperiment::PrintReceiveList ()
   // Rui: print out to files for charts, tables and figures.
   myfile << num_of_received_2 << "," << aveage_value << "," << packet_loss_rate << "," << packet_loss_rate_after_recovery  
   << "," << packet_recovery_rate << "," << 1000.0*average_end_to_end_delay/legal_dealy<< ","<< 1000.0*average_end_to_end_delay_raw/end_delay.size() << "," <<  (average_masking/masking_time.size())/1000000.0 
-  << "," << (average_handle/stat_network_coding_time.size())/1000000.0 << "," << recovery_time/1000000.0 << "\n";
+  << "," << (average_handle/crs.stat_network_coding_time.size())/1000000.0 << "," << recovery_time/1000000.0 << "," << average_frames << "," << time_to_recover << "\n";
   myfile.close();
 
 
@@ -1482,8 +1666,17 @@ VanetRoutingExperiment::SetupAdhocMobilityNodes ()
 {
   if (m_mobility == 1)
     {
-      Ns2MobilityHelper ns2 = Ns2MobilityHelper (m_traceFile);
-      ns2.Install (); // configure movements for each node, while reading trace file
+      //Rui: the binary trace made by Rui_trace_convert.cc is mapped instead of parsed, when it exists
+      std::string binaryTrace = FindBinaryMobilityTrace (m_traceFile);
+      if (!binaryTrace.empty ())
+        {
+          BinaryMobilityHelper (binaryTrace).Install (); // waypoints are scheduled as the simulation reaches them
+        }
+      else
+        {
+          Ns2MobilityHelper ns2 = Ns2MobilityHelper (m_traceFile);
+          ns2.Install (); // configure movements for each node, while reading trace file
+        }
     }
   else if (m_mobility == 2)
     {
@@ -1516,11 +1709,20 @@ void
 VanetRoutingExperiment::SetupRoutingNodesFromMobNodes()
 {
   
-  
-  for (uint32_t node_index = 0; node_index < group_size; node_index ++) //RuiTest
-  {  
-     Ptr<Node> p = m_mobilityNodes.Get(node_list[node_index]);
-     m_adhocTxNodes.Add(p);
+  if (cluster_form_time >= 0)
+  {
+    //the clusters are formed later from the positions, so every vehicle routes
+    m_adhocTxNodes.Add(m_mobilityNodes);
+    NS_LOG_UNCOND("sub_node_contaniner generated.");
+    return;
+  }
+  for (uint32_t k = 0; k < cluster_list.size(); k++) //one cluster after the other
+  {
+    for (uint32_t node_index = 0; node_index < group_size; node_index ++) //RuiTest
+    {  
+       Ptr<Node> p = m_mobilityNodes.Get(cluster_list[k][node_index]);
+       m_adhocTxNodes.Add(p);
+    }
   }
   NS_LOG_UNCOND("sub_node_contaniner generated.");
 
@@ -1592,6 +1794,7 @@ VanetRoutingExperiment::SetupAdhocDevices ()
 
   wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
   
+  double max_range = 0; //MaxRange of the range loss models, 0 for the others
   if (m_lossModel == 3)
     {
       // two-ray requires antenna height (else defaults to Friss)
@@ -1608,7 +1811,8 @@ VanetRoutingExperiment::SetupAdhocDevices ()
     {
       //Config::SetDefault( "ns3::RangePropagationLossModel::MaxRange", DoubleValue( *100.0* ) ); 
       cout<<"wifiChannel add propagation loss:"<< m_lossModelName <<endl;
-      wifiChannel.AddPropagationLoss (m_lossModelName, "MaxRange", DoubleValue (100.0));
+      max_range = 100.0;
+      wifiChannel.AddPropagationLoss (m_lossModelName, "MaxRange", DoubleValue (max_range));
     }
   // Propagation loss models are additive.
 
@@ -1617,7 +1821,8 @@ VanetRoutingExperiment::SetupAdhocDevices ()
       //Config::SetDefault( "ns3::RangePropagationLossModel::MaxRange", DoubleValue( *100.0* ) ); 
       cout<<"wifiChannel add propagation loss: range plus two-ray" <<endl;
       wifiChannel.AddPropagationLoss ("ns3::TwoRayGroundPropagationLossModel", "Frequency", DoubleValue (freq), "HeightAboveZ", DoubleValue (1.5));//1.5 RuiTestLoss
-      wifiChannel.AddPropagationLoss (m_lossModelName, "MaxRange", DoubleValue (200.0));
+      max_range = 200.0;
+      wifiChannel.AddPropagationLoss (m_lossModelName, "MaxRange", DoubleValue (max_range));
     }
 
   if (m_fading != 0)
@@ -1633,6 +1838,12 @@ VanetRoutingExperiment::SetupAdhocDevices ()
     
   // the channel
   Ptr<YansWifiChannel> channel = wifiChannel.Create ();
+  //Rui: beyond MaxRange the received power is always too weak, so only the vehicles within it
+  //need a reception (see yans-wifi-channel.h). Other models: --ns3::YansWifiChannel::CullingDistance=<m>
+  if (max_range > 0)
+    {
+      channel->SetAttribute ("CullingDistance", DoubleValue (max_range));
+    }
 
   // The below set of helpers will help us to put together the wifi NICs we want
   YansWifiPhyHelper wifiPhy;// =  YansWifiPhyHelper::Default ();
@@ -1735,7 +1946,7 @@ VanetRoutingExperiment::SetupScenario ()
   if (m_scenario == 1)
     {
       // 40 nodes in RWP 300 m x 1500 m synthetic highway, 10s
-      m_traceFile = "tracefile/trace_acosta_rui.tcl";
+      m_traceFile = mobility_trace.empty () ? "tracefile/trace_acosta_rui.tcl" : mobility_trace;
       m_logFile = "";
       m_mobility = 1;
       m_lossModel = 7;
@@ -1743,6 +1954,11 @@ VanetRoutingExperiment::SetupScenario ()
         {
           m_nNodes = 1004; 
         }
+      MobilityTraceFile binaryTrace; //Rui: a binary trace knows its number of vehicles, e.g. a subset of Rui_trace_subset.cc
+      if (binaryTrace.Open (FindBinaryMobilityTrace (m_traceFile)))
+        {
+          m_nNodes = binaryTrace.GetNodeCount ();
+        }
       if (m_TotalSimTime == 300.01)
         {
           m_TotalSimTime = 20; //Rui:similuation time
@@ -1771,9 +1987,13 @@ main (int argc, char *argv[])
 
   SeedManager::SetSeed (m_seed);
   cout<<"Seed:"<<m_seed<<endl;*/
+  ClusterConfig cluster;
   CommandLine cmd;
   cmd.AddValue ("seed", "randomize seed", m_seed);
+  cmd.AddValue ("mobilityTrace", "ns-2 or binary mobility trace, e.g. a subset made by Rui_trace_subset.cc", mobility_trace);
+  cluster.AddCommandLineValues (cmd);
   cmd.Parse (argc, argv);
+  cluster.Apply ();
 
   SeedManager::SetSeed (m_seed);
 
@@ -0,0 +1,332 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2006,2007 INRIA
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Mathieu Lacage, <mathieu.lacage@sophia.inria.fr>
+ */
+
+// Rui: with the CullingDistance attribute, a transmission is only delivered to the
+// PHYs within that distance of the sender. With 1000+ vehicles in the Bologna
+// scenario, most of them are far beyond the radio range of a sender, and scheduling
+// a reception on each of them dominated the run time.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/pointer.h"
+#include "ns3/double.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/mobility-model.h"
+#include "yans-wifi-channel.h"
+#include "yans-wifi-phy.h"
+#include "wifi-utils.h"
+#include "wifi-ppdu.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("YansWifiChannel");
+
+NS_OBJECT_ENSURE_REGISTERED (YansWifiChannel);
+
+namespace {
+/// Rui: cell of a PHY not placed yet
+const int64_t NO_CELL = std::numeric_limits<int64_t>::min ();
+
+/// Rui: key of the cell at column x and row y
+int64_t
+CellKey (int64_t x, int64_t y)
+{
+  return (int64_t) (((uint64_t) x << 32) ^ (uint32_t) y);
+}
+}
+
+TypeId
+YansWifiChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::YansWifiChannel")
+    .SetParent<Channel> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<YansWifiChannel> ()
+    .AddAttribute ("PropagationLossModel", "A pointer to the propagation loss model attached to this channel.",
+                   PointerValue (),
+                   MakePointerAccessor (&YansWifiChannel::m_loss),
+                   MakePointerChecker<PropagationLossModel> ())
+    .AddAttribute ("PropagationDelayModel", "A pointer to the propagation delay model attached to this channel.",
+                   PointerValue (),
+                   MakePointerAccessor (&YansWifiChannel::m_delay),
+                   MakePointerChecker<PropagationDelayModel> ())
+    .AddAttribute ("CullingDistance", "Only deliver a transmission to the PHYs within this distance (m) of the sender, "
+                   "0 to deliver it to every PHY. Must not be below the distance at which the received power "
+                   "falls below the receive sensitivity.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&YansWifiChannel::m_cullingDistance),
+                   MakeDoubleChecker<double> (0.0))
+  ;
+  return tid;
+}
+
+YansWifiChannel::YansWifiChannel ()
+  : m_cullingDistance (0.0),
+    m_indexed (0),
+    m_maxSpeed (0.0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+YansWifiChannel::~YansWifiChannel ()
+{
+  NS_LOG_FUNCTION (this);
+  m_phyList.clear ();
+}
+
+void
+YansWifiChannel::SetPropagationLossModel (const Ptr<PropagationLossModel> loss)
+{
+  NS_LOG_FUNCTION (this << loss);
+  m_loss = loss;
+}
+
+void
+YansWifiChannel::SetPropagationDelayModel (const Ptr<PropagationDelayModel> delay)
+{
+  NS_LOG_FUNCTION (this << delay);
+  m_delay = delay;
+}
+
+void
+YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const
+{
+  NS_LOG_FUNCTION (this << sender << ppdu << txPowerDbm);
+  Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
+  NS_ASSERT (senderMobility != 0);
+
+  //Rui: PHY indexes to deliver to, every PHY without culling
+  std::vector<uint32_t> receivers;
+  if (m_cullingDistance > 0)
+    {
+      Candidates (sender, senderMobility, receivers);
+    }
+  else
+    {
+      receivers.resize (m_phyList.size ());
+      for (uint32_t j = 0; j < m_phyList.size (); j++)
+        {
+          receivers[j] = j;
+        }
+    }
+
+  for (uint32_t j : receivers)
+    {
+      Ptr<YansWifiPhy> phy = m_phyList[j];
+      if (sender != phy)
+        {
+          //For now don't account for inter channel interference nor channel bonding
+          if (phy->GetChannelNumber () != sender->GetChannelNumber ())
+            {
+              continue;
+            }
+
+          Ptr<MobilityModel> receiverMobility = phy->GetMobility ()->GetObject<MobilityModel> ();
+          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
+          double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+          NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
+                        "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
+          Ptr<WifiPpdu> copy = Copy (ppdu);
+          Ptr<NetDevice> dstNetDevice = phy->GetDevice ();
+          uint32_t dstNode;
+          if (dstNetDevice == 0)
+            {
+              dstNode = 0xffffffff;
+            }
+          else
+            {
+              dstNode = dstNetDevice->GetNode ()->GetId ();
+            }
+
+          Simulator::ScheduleWithContext (dstNode,
+                                          delay, &YansWifiChannel::Receive,
+                                          phy, copy, rxPowerDbm);
+        }
+    }
+}
+
+void
+YansWifiChannel::Receive (Ptr<YansWifiPhy> phy, Ptr<WifiPpdu> ppdu, double rxPowerDbm)
+{
+  NS_LOG_FUNCTION (phy << ppdu << rxPowerDbm);
+  // Do no further processing if signal is too weak
+  // Current implementation assumes constant RX power over the PPDU duration
+  if ((rxPowerDbm + phy->GetRxGain ()) < phy->GetRxSensitivity ())
+    {
+      NS_LOG_INFO ("Received signal too weak to process: " << rxPowerDbm << " dBm");
+      return;
+    }
+  RxPowerWattPerChannelBand rxPowersW;
+  auto band = phy->GetBand (phy->GetChannelWidth ());
+  rxPowersW.insert ({band, (DbmToW (rxPowerDbm + phy->GetRxGain ()))});
+  phy->StartReceivePreamble (ppdu, rxPowersW);
+}
+
+std::size_t
+YansWifiChannel::GetNDevices (void) const
+{
+  return m_phyList.size ();
+}
+
+Ptr<NetDevice>
+YansWifiChannel::GetDevice (std::size_t i) const
+{
+  return m_phyList[i]->GetDevice ();
+}
+
+void
+YansWifiChannel::Add (Ptr<YansWifiPhy> phy)
+{
+  NS_LOG_FUNCTION (this << phy);
+  m_phyList.push_back (phy);
+}
+
+int64_t
+YansWifiChannel::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  int64_t currentStream = stream;
+  currentStream += m_loss->AssignStreams (stream);
+  return (currentStream - stream);
+}
+
+//----------------------------------------------------------------------
+//-- Rui: grid of the PHY positions
+//------------------------------------------------------
+
+int64_t
+YansWifiChannel::CellOf (const Vector &position) const
+{
+  int64_t x = (int64_t) std::floor (position.x / m_cullingDistance);
+  int64_t y = (int64_t) std::floor (position.y / m_cullingDistance);
+  return CellKey (x, y);
+}
+
+void
+YansWifiChannel::Place (uint32_t i) const
+{
+  int64_t cell = CellOf (m_phyList[i]->GetMobility ()->GetPosition ());
+  int64_t old_cell = m_cellOfPhy[i];
+  if (cell == old_cell)
+    {
+      return;
+    }
+  if (old_cell != NO_CELL)
+    {
+      std::vector<uint32_t> &phys = m_cells[old_cell];
+      *std::find (phys.begin (), phys.end (), i) = phys.back ();
+      phys.pop_back ();
+      if (phys.empty ())
+        {
+          m_cells.erase (old_cell);
+        }
+    }
+  m_cells[cell].push_back (i);
+  m_cellOfPhy[i] = cell;
+}
+
+void
+YansWifiChannel::IndexNewPhys (void) const
+{
+  m_cellOfPhy.resize (m_phyList.size (), NO_CELL);
+  for (; m_indexed < m_phyList.size (); m_indexed++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[m_indexed]->GetMobility ()->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != 0);
+      std::vector<uint32_t> &phys = m_phyOfMobility[PeekPointer (mobility)];
+      if (phys.empty ())
+        {
+          mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&YansWifiChannel::CourseChanged, this));
+        }
+      phys.push_back (m_indexed);
+      Vector velocity = mobility->GetVelocity ();
+      m_maxSpeed = std::max (m_maxSpeed, velocity.GetLength ());
+      Place (m_indexed);
+    }
+}
+
+void
+YansWifiChannel::CourseChanged (Ptr<const MobilityModel> mobility) const
+{
+  auto it = m_phyOfMobility.find (PeekPointer (mobility));
+  if (it == m_phyOfMobility.end ())
+    {
+      return;
+    }
+  Vector velocity = mobility->GetVelocity ();
+  m_maxSpeed = std::max (m_maxSpeed, velocity.GetLength ());
+  for (uint32_t i : it->second)
+    {
+      Place (i);
+    }
+}
+
+void
+YansWifiChannel::Candidates (Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                             std::vector<uint32_t> &candidates) const
+{
+  IndexNewPhys ();
+
+  // a PHY moves between its course changes, by at most m_maxSpeed since the grid was last refreshed
+  double margin = m_maxSpeed * (Simulator::Now () - m_refreshTime).GetSeconds ();
+  if (margin > 0.5 * m_cullingDistance)
+    {
+      for (uint32_t i = 0; i < m_indexed; i++)
+        {
+          Place (i);
+        }
+      m_refreshTime = Simulator::Now ();
+      margin = 0;
+    }
+
+  Vector position = senderMobility->GetPosition ();
+  int64_t x = (int64_t) std::floor (position.x / m_cullingDistance);
+  int64_t y = (int64_t) std::floor (position.y / m_cullingDistance);
+  int64_t rings = (int64_t) std::ceil ((m_cullingDistance + margin) / m_cullingDistance);
+  for (int64_t dx = -rings; dx <= rings; dx++)
+    {
+      for (int64_t dy = -rings; dy <= rings; dy++)
+        {
+          auto it = m_cells.find (CellKey (x + dx, y + dy));
+          if (it == m_cells.end ())
+            {
+              continue;
+            }
+          for (uint32_t i : it->second)
+            {
+              if (m_phyList[i] != sender
+                  && senderMobility->GetDistanceFrom (m_phyList[i]->GetMobility ()) <= m_cullingDistance)
+                {
+                  candidates.push_back (i);
+                }
+            }
+        }
+    }
+  // same order as without culling, so the receptions are scheduled in the same order
+  std::sort (candidates.begin (), candidates.end ());
+}
+
+} //namespace ns3
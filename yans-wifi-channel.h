@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2006,2007 INRIA
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Mathieu Lacage, <mathieu.lacage@sophia.inria.fr>
+ */
+
+// Rui: with the CullingDistance attribute, a transmission is only delivered to the
+// PHYs within that distance of the sender, found with a grid of the PHY positions
+
+#ifndef YANS_WIFI_CHANNEL_H
+#define YANS_WIFI_CHANNEL_H
+
+#include <unordered_map>
+#include <vector>
+#include "ns3/channel.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+class NetDevice;
+class PropagationLossModel;
+class PropagationDelayModel;
+class YansWifiPhy;
+class WifiPpdu;
+class MobilityModel;
+
+/**
+ * \brief a channel to interconnect ns3::YansWifiPhy objects.
+ * \ingroup wifi
+ *
+ * This class is expected to be used in tandem with the ns3::YansWifiPhy
+ * class and supports an ns3::PropagationLossModel and an
+ * ns3::PropagationDelayModel.  By default, no propagation models are set;
+ * it is the caller's responsibility to set them before using the channel.
+ *
+ * When CullingDistance is positive, the PHYs are kept in a grid of cells
+ * of that size, moved when their mobility model reports a course change,
+ * and a transmission only reaches the PHYs within CullingDistance of the
+ * sender. It must be at least the distance beyond which the received
+ * power is always below the receive sensitivity (e.g. the MaxRange of a
+ * RangePropagationLossModel), otherwise receptions are lost.
+ */
+class YansWifiChannel : public Channel
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  YansWifiChannel ();
+  virtual ~YansWifiChannel ();
+
+  std::size_t GetNDevices (void) const override;
+  Ptr<NetDevice> GetDevice (std::size_t i) const override;
+
+  /**
+   * Adds the given YansWifiPhy to the PHY list
+   *
+   * \param phy the YansWifiPhy to be added to the PHY list
+   */
+  void Add (Ptr<YansWifiPhy> phy);
+
+  /**
+   * \param loss the new propagation loss model.
+   */
+  void SetPropagationLossModel (const Ptr<PropagationLossModel> loss);
+  /**
+   * \param delay the new propagation delay model.
+   */
+  void SetPropagationDelayModel (const Ptr<PropagationDelayModel> delay);
+
+  /**
+   * \param sender the PHY object from which the packet is originating.
+   * \param ppdu the PPDU to send
+   * \param txPowerDbm the TX power associated to the packet, in dBm
+   *
+   * This method should not be invoked by normal users. It is
+   * currently invoked only from YansWifiPhy::StartTx.  The channel
+   * attempts to deliver the PPDU to all other YansWifiPhy objects
+   * on the channel (except for the sender), or to those within
+   * CullingDistance of the sender.
+   */
+  void Send (Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.  Return the number of streams (possibly zero) that
+   * have been assigned.
+   *
+   * \param stream first stream index to use
+   *
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+
+private:
+  /**
+   * A vector of pointers to YansWifiPhy.
+   */
+  typedef std::vector<Ptr<YansWifiPhy> > PhyList;
+
+  /**
+   * This method is scheduled by Send for each associated YansWifiPhy.
+   * The method then calls the corresponding YansWifiPhy that the first
+   * bit of the packet has arrived.
+   *
+   * \param receiver the device to which the packet is destined
+   * \param ppdu the PPDU being sent
+   * \param txPowerDbm the TX power associated to the packet being sent (dBm)
+   */
+  static void Receive (Ptr<YansWifiPhy> receiver, Ptr<WifiPpdu> ppdu, double txPowerDbm);
+
+  /// Rui: grid cell of a position
+  int64_t CellOf (const Vector &position) const;
+  /// Rui: put PHY i in the cell of its current position
+  void Place (uint32_t i) const;
+  /// Rui: follow the course changes of the PHYs added since the last call
+  void IndexNewPhys (void) const;
+  /// Rui: CourseChange trace sink
+  void CourseChanged (Ptr<const MobilityModel> mobility) const;
+  /// Rui: indexes of the PHYs within CullingDistance of the sender, in PHY list order
+  void Candidates (Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility, std::vector<uint32_t> &candidates) const;
+
+  PhyList m_phyList;                   //!< List of YansWifiPhys connected to this YansWifiChannel
+  Ptr<PropagationLossModel> m_loss;    //!< Propagation loss model
+  Ptr<PropagationDelayModel> m_delay;  //!< Propagation delay model
+
+  double m_cullingDistance;            //!< Rui: 0 to reach every PHY
+  mutable uint32_t m_indexed;          //!< Rui: PHYs followed by the grid, the first ones of m_phyList
+  mutable std::unordered_map<int64_t, std::vector<uint32_t> > m_cells; //!< Rui: PHYs of each cell
+  mutable std::vector<int64_t> m_cellOfPhy;                            //!< Rui: cell of each followed PHY
+  mutable std::unordered_map<const MobilityModel *, std::vector<uint32_t> > m_phyOfMobility; //!< Rui: PHYs moved by each mobility model
+  mutable double m_maxSpeed;           //!< Rui: fastest speed seen, bounds the drift between course changes
+  mutable Time m_refreshTime;          //!< Rui: every PHY was placed at its position of that time
+};
+
+} //namespace ns3
+
+#endif /* YANS_WIFI_CHANNEL_H */